@@ -0,0 +1,103 @@
+//
+//  Arena.hpp
+//  compiler
+//
+
+#ifndef Arena_hpp
+#define Arena_hpp
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#define ARENA_BLOCK_SIZE 65536  // bytes per arena block, larger requests get a block of their own
+
+// bump pointer allocator for the interned strings of one compilation,
+// nothing is freed on its own, all blocks are released together
+class Arena {
+private:
+    std::vector<char *> blocks;
+    char * next;
+    size_t remaining;
+
+public:
+    Arena() {
+        next = nullptr;
+        remaining = 0;
+    }
+
+    ~Arena() {
+        release();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena & operator=(const Arena &) = delete;
+
+    // blocks move with the arena, so pointers into them stay valid
+    Arena(Arena && other) {
+        blocks.swap(other.blocks);
+        next = other.next;
+        remaining = other.remaining;
+        other.next = nullptr;
+        other.remaining = 0;
+    }
+
+    void * allocate(size_t size, size_t align) {
+        size_t padding = (align - reinterpret_cast<size_t>(next) % align) % align;
+        if (next == nullptr || padding + size > remaining) {
+            size_t blockSize = size + align > ARENA_BLOCK_SIZE ? size + align : ARENA_BLOCK_SIZE;
+            char * block = static_cast<char *>(std::malloc(blockSize));
+            if (block == nullptr) throw std::bad_alloc();
+            blocks.push_back(block);
+            next = block;
+            remaining = blockSize;
+            padding = (align - reinterpret_cast<size_t>(next) % align) % align;
+        }
+        void * result = next + padding;
+        next += padding + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    // copy length chars and a terminating '\0' into the arena
+    const char * copyString(const char * str, size_t length) {
+        char * result = static_cast<char *>(allocate(length + 1, 1));
+        std::memcpy(result, str, length);
+        result[length] = '\0';
+        return result;
+    }
+
+    // free every block at once
+    void release() {
+        for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+            std::free(blocks[i]);
+        }
+        blocks.clear();
+        next = nullptr;
+        remaining = 0;
+    }
+};
+
+// a string stored in an Arena, or a view of a std::string while looking one up
+struct ArenaString {
+    const char * data;
+    size_t length;
+
+    bool operator==(const ArenaString & other) const {
+        return length == other.length && std::memcmp(data, other.data, length) == 0;
+    }
+};
+
+struct ArenaStringHash {
+    size_t operator()(const ArenaString & str) const {
+        size_t hash = 14695981039346656037ULL;  // FNV-1a
+        for (size_t i = 0; i < str.length; i++) {
+            hash = (hash ^ static_cast<unsigned char>(str.data[i])) * 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+#endif /* Arena_hpp */
@@ -0,0 +1,82 @@
+//
+//  CFG.hpp
+//  compiler
+//
+
+#ifndef CFG_hpp
+#define CFG_hpp
+
+#include <vector>
+#include <algorithm>
+#include "ICode.hpp"
+
+// a run of quads entered only at the first one and left only after the last one
+struct BasicBlock {
+    int label;  // label id of the first quad, 0 if it has none
+    int first;  // quads [first, last)
+    int last;
+    std::vector<int> successors;
+    std::vector<int> predecessors;
+};
+
+// control flow graph of the quad list, one function body starts at each FUNC.
+// CALL does not end a block, the callee returns to the next quad.
+class CFG {
+private:
+    std::vector<BasicBlock> blocks;
+    std::vector<int> labelBlock;  // label id -> block index, -1 if the label is on no quad
+
+    static bool endsBlock(ICODEOP op) {
+        return op == JMP || op == BF || op == BT || op == RTN || op == RETURN || op == STOP;
+    }
+
+    static bool fallsThrough(ICODEOP op) {
+        return op != JMP && op != RTN && op != RETURN && op != STOP;
+    }
+
+    void addEdge(int from, int to) {
+        if (std::find(blocks[from].successors.begin(), blocks[from].successors.end(), to) != blocks[from].successors.end()) return;
+        blocks[from].successors.push_back(to);
+        blocks[to].predecessors.push_back(from);
+    }
+
+public:
+    // labels in the quads must already be resolved, labelCount is the number of label ids
+    void build(const std::vector<QUAD> & quad, int labelCount) {
+        blocks.clear();
+        labelBlock.assign(labelCount, -1);
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (blocks.empty() || quad[i].label != 0 || endsBlock(quad[i - 1].opcode)) {
+                if (!blocks.empty()) blocks.back().last = i;
+                blocks.push_back({ quad[i].label, i, i, {}, {} });
+                if (quad[i].label != 0) labelBlock[quad[i].label] = static_cast<int>(blocks.size()) - 1;
+            }
+        }
+        if (!blocks.empty()) blocks.back().last = static_cast<int>(quad.size());
+
+        for (int b = 0; b < static_cast<int>(blocks.size()); b++) {
+            const QUAD & tail = quad[blocks[b].last - 1];
+            if (tail.opcode == JMP && tail.operand1.kind == O_Label && labelBlock[tail.operand1.value] >= 0)
+                addEdge(b, labelBlock[tail.operand1.value]);
+            else if ((tail.opcode == BF || tail.opcode == BT) && tail.operand2.kind == O_Label && labelBlock[tail.operand2.value] >= 0)
+                addEdge(b, labelBlock[tail.operand2.value]);
+            if (fallsThrough(tail.opcode) && b + 1 < static_cast<int>(blocks.size()) && quad[blocks[b + 1].first].opcode != FUNC)
+                addEdge(b, b + 1);
+        }
+    }
+
+    int size() {
+        return static_cast<int>(blocks.size());
+    }
+
+    BasicBlock & getBlock(int index) {
+        return blocks[index];
+    }
+
+    // block that starts with the label, -1 if none
+    int getLabelBlock(int label) {
+        return label < static_cast<int>(labelBlock.size()) ? labelBlock[label] : -1;
+    }
+};
+
+#endif /* CFG_hpp */
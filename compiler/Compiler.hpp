@@ -16,23 +16,45 @@
 #include <map>
 #include "Scanner.hpp"
 #include "SymTable.hpp"
+#include "Optimizer.hpp"
+#include "RegAlloc.hpp"
+#include "Peephole.hpp"
 
 struct OpRec {
     std::string value;
     int priority;
 };
 
+enum SARType {
+    S_Id,
+    S_Lit,
+    S_Type,
+    S_This,
+    S_Variable,
+    S_Ref,
+    S_Bal,
+    S_Al,
+    S_Func,
+    S_Arr,
+    S_New,
+    S_Tvar,
+    S_Rtn
+};
+
+// value is a string handle of the SymTable, action names the routine that made it
 struct SAR {
     int symID;
     int lineNumber;
-    std::string reference;
-    std::string value;
-    std::string action;
+    SARType reference;
+    int value;
+    const char * action;
 };
 
 class Compiler {
 private:
     std::string sourceCodeFilename;
+    std::shared_ptr<SourceFile> source;  // source mapped in pass 1, kept for pass 2
+    std::vector<TokenView> sourceTokens;  // tokens lexed in pass 1, replayed by pass 2
     SymTable symbolTable;
     std::string currentClass;
     std::string currentMethod;
@@ -42,9 +64,10 @@ private:
     int classInitOffset;
     int methodOffset;
     int currentMethodId;
+    int optimizationLevel;  // -O level, 0 generates code straight from the quads
+    bool peephole;  // clean up the target code, on at -O1 and above
     std::stack<OpRec> OpStack;
     std::stack<SAR> SAS;
-    std::map<std::string, int> operatorTable;
 
 public:
     Compiler(std::string filename) {
@@ -54,24 +77,17 @@ public:
         currentParam = "";
         flagOfPass = false;
         currentMethodId = 0;
-        
-        operatorTable.insert(std::pair<std::string, int>("*",8));
-        operatorTable.insert(std::pair<std::string, int>("/",8));
-        operatorTable.insert(std::pair<std::string, int>("+",7));
-        operatorTable.insert(std::pair<std::string, int>("-",7));
-        operatorTable.insert(std::pair<std::string, int>("<",6));
-        operatorTable.insert(std::pair<std::string, int>("<=",6));
-        operatorTable.insert(std::pair<std::string, int>(">",6));
-        operatorTable.insert(std::pair<std::string, int>(">=",6));
-        operatorTable.insert(std::pair<std::string, int>("==",5));
-        operatorTable.insert(std::pair<std::string, int>("!=",5));
-        operatorTable.insert(std::pair<std::string, int>("&&",4));
-        operatorTable.insert(std::pair<std::string, int>("||",3));
-        operatorTable.insert(std::pair<std::string, int>("=",2));
-        operatorTable.insert(std::pair<std::string, int>("(",1));
-        operatorTable.insert(std::pair<std::string, int>(")",1));
-        operatorTable.insert(std::pair<std::string, int>("[",1));
-        operatorTable.insert(std::pair<std::string, int>("]",1));
+        optimizationLevel = 0;
+        peephole = false;
+    }
+    
+    void setOptimizationLevel(int level) {
+        optimizationLevel = level;
+        if (level > 0) peephole = true;
+    }
+    
+    void setPeephole(bool enabled) {
+        peephole = enabled;
     }
     
     void syntaxError(Token token, std::string expected) {
@@ -524,10 +540,10 @@ public:
     }
     
     void statement(Scanner & scanner) {
-        std::string labelENDIF = "";
-        std::string labelSKIPELSE = "";
-        std::string labelBEGIN = "";
-        std::string labelENDWHILE = "";
+        int labelENDIF = 0;
+        int labelSKIPELSE = 0;
+        int labelBEGIN = 0;
+        int labelENDWHILE = 0;
         if (scanner.getToken().lexeme == "{") {
             scanner.fetchTokens();
             while (scanner.getToken().lexeme != "}") {
@@ -549,8 +565,8 @@ public:
                 if (flagOfPass) {
                     sa_ClosingParenthesis();
                     int labelCnt = symbolTable.getNewLabelCount();
-                    labelENDIF = "SKIPIF" + std::to_string(labelCnt);
-                    labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
+                    labelENDIF = symbolTable.newLabel("SKIPIF" + std::to_string(labelCnt));
+                    labelSKIPELSE = symbolTable.newLabel("SKIPELSE" + std::to_string(labelCnt));
                     sa_if(labelENDIF, scanner.getToken().lineNumber);
                 }
                 scanner.fetchTokens();
@@ -561,7 +577,7 @@ public:
             statement(scanner);
             if (scanner.getToken().lexeme == "else") {
                 if (flagOfPass) {
-                    symbolTable.iCode(scanner.getToken().lineNumber, JMP, labelSKIPELSE, "", "", "");
+                    symbolTable.iCode(scanner.getToken().lineNumber, JMP, opLabel(labelSKIPELSE));
                     symbolTable.iCodeLabel(labelENDIF);
                     labelENDIF = labelSKIPELSE;
                 }
@@ -575,8 +591,8 @@ public:
             if (scanner.getToken().lexeme == "(") {
                 if (flagOfPass) {
                     int labelCnt = symbolTable.getNewLabelCount();
-                    labelBEGIN = "BEGIN" + std::to_string(labelCnt);
-                    labelENDWHILE = "ENDWHILE" + std::to_string(labelCnt);
+                    labelBEGIN = symbolTable.newLabel("BEGIN" + std::to_string(labelCnt));
+                    labelENDWHILE = symbolTable.newLabel("ENDWHILE" + std::to_string(labelCnt));
                     symbolTable.iCodeLabel(labelBEGIN);
                     sa_oPush(scanner.getToken());
                 }
@@ -598,7 +614,7 @@ public:
             }
             statement(scanner);
             if (flagOfPass) {
-                symbolTable.iCode(scanner.getToken().lineNumber, JMP, labelBEGIN, "", "", "");
+                symbolTable.iCode(scanner.getToken().lineNumber, JMP, opLabel(labelBEGIN));
                 symbolTable.iCodeLabel(labelENDWHILE);
             }
         }
@@ -607,7 +623,7 @@ public:
             if (scanner.getToken().lexeme != ";") {
                 expression(scanner);
             } else if (flagOfPass) {
-                SAR newSAR = {0, scanner.getToken().lineNumber, "rtn_sar", "RTN", "sa_return"};
+                SAR newSAR = {0, scanner.getToken().lineNumber, S_Rtn, symbolTable.intern("RTN"), "sa_return"};
                 SAS.push(newSAR);
             }
             if (scanner.getToken().lexeme == ";") {
@@ -652,6 +668,17 @@ public:
                 syntaxError(scanner.getToken(), ";");
             }
         }
+        else if (scanner.getToken().lexeme == "delete") {
+            scanner.fetchTokens();
+            expression(scanner);
+            if (scanner.getToken().lexeme == ";") {
+                if (flagOfPass) sa_delete(scanner.getToken().lineNumber);
+                scanner.fetchTokens();
+            }
+            else {
+                syntaxError(scanner.getToken(), ";");
+            }
+        }
         else if (scanner.getToken().lexeme == "switch") {
             scanner.fetchTokens();
             if (scanner.getToken().lexeme == "(") {
@@ -764,7 +791,7 @@ public:
             else {
                 currentMethodId = symbolTable.searchValue("g" + currentClass, nameStr);
                 if (currentMethodId == 0) unexpectedError("Cannot find function symID");
-                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, symbolTable.getSymID(currentMethodId), "", "", symbolTable.getSymID(currentMethodId));
+                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, opSym(currentMethodId), opNone(), opNone(), symbolTable.newLabel(symbolTable.getSymID(currentMethodId)));
                 methodOffset = initialMethodOffset(currentMethodId);
             }
             method_body(scanner);
@@ -839,7 +866,7 @@ public:
                 sa_CD(scanner.getToken());
                 currentMethodId = symbolTable.searchValue("g" + currentClass, nameStr);
                 if (currentMethodId == 0) unexpectedError("Cannot find Constructor symID");
-                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, symbolTable.getSymID(currentMethodId), "", "", symbolTable.getSymID(currentMethodId));
+                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, opSym(currentMethodId), opNone(), opNone(), symbolTable.newLabel(symbolTable.getSymID(currentMethodId)));
                 methodOffset = initialMethodOffset(currentMethodId);
             }
             scanner.fetchTokens();
@@ -863,8 +890,8 @@ public:
             }
             else {
                 int classInitId = symbolTable.searchValue("g" + currentClass, currentClass.substr(1) + "StaticInit");
-                symbolTable.iCode(scanner.getToken().lineNumber, FRAME, symbolTable.getSymID(classInitId), "this", "", "");
-                symbolTable.iCode(scanner.getToken().lineNumber, CALL, symbolTable.getSymID(classInitId), "", "", "");
+                symbolTable.iCode(scanner.getToken().lineNumber, FRAME, opSym(classInitId), opThis());
+                symbolTable.iCode(scanner.getToken().lineNumber, CALL, opSym(classInitId));
             }
             method_body(scanner);
             currentMethod = "";
@@ -946,7 +973,7 @@ public:
             std::string initializerName = currentClass.substr(1) + "StaticInit";
             classInitId = symbolTable.insert("g" + currentClass, "M", initializerName, "method", "", "void", "[]", "private", 0);
             symbolTable.setStaticInitICode(true);
-            symbolTable.iCode(scanner.getToken().lineNumber, FUNC, symbolTable.getSymID(classInitId), "", "", symbolTable.getSymID(classInitId));
+            symbolTable.iCode(scanner.getToken().lineNumber, FUNC, opSym(classInitId), opNone(), opNone(), symbolTable.newLabel(symbolTable.getSymID(classInitId)));
             symbolTable.setStaticInitICode(false);
         }
         if (scanner.getToken().lexeme == "{") {
@@ -961,16 +988,16 @@ public:
         if (flagOfPass) {
             symbolTable.updateOffset(classInitId, classInitOffset);
             symbolTable.setStaticInitICode(true);
-            symbolTable.iCode(scanner.getToken().lineNumber, RTN, "", "", "", "");
+            symbolTable.iCode(scanner.getToken().lineNumber, RTN);
             symbolTable.setStaticInitICode(false);
             symbolTable.dumpStaticICode();
             int constructorId = symbolTable.searchValue("g" + currentClass, currentClass.substr(1));
             if (constructorId == 0) {
                 int tempId = symbolTable.insert("g" + currentClass, "X", currentClass.substr(1), "Constructor", "", currentClass.substr(1), "[]", "public", 12);
-                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, symbolTable.getSymID(tempId), "", "", symbolTable.getSymID(tempId));
-                symbolTable.iCode(scanner.getToken().lineNumber, FRAME, symbolTable.getSymID(classInitId), "this", "", "");
-                symbolTable.iCode(scanner.getToken().lineNumber, CALL, symbolTable.getSymID(classInitId), "", "", "");
-                symbolTable.iCode(scanner.getToken().lineNumber, RETURN, "this", "", "", "");
+                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, opSym(tempId), opNone(), opNone(), symbolTable.newLabel(symbolTable.getSymID(tempId)));
+                symbolTable.iCode(scanner.getToken().lineNumber, FRAME, opSym(classInitId), opThis());
+                symbolTable.iCode(scanner.getToken().lineNumber, CALL, opSym(classInitId));
+                symbolTable.iCode(scanner.getToken().lineNumber, RETURN, opThis());
             }
         }
         scanner.fetchTokens();  //comsume the closing "}"
@@ -1051,10 +1078,10 @@ public:
         if (flagOfPass) {
             int tempId = symbolTable.searchValue("g" + currentClass, currentMethod.substr(1));
             if (tempId == 0) unexpectedError("Cannot find currentMethod symID");
-            if (symbolTable.getKind(tempId) == "Constructor")
-                symbolTable.iCode(scanner.getToken().lineNumber, RETURN, "this", "", "", "");
+            if (symbolTable.getKindCode(tempId) == K_Constructor)
+                symbolTable.iCode(scanner.getToken().lineNumber, RETURN, opThis());
             else
-                symbolTable.iCode(scanner.getToken().lineNumber, RTN, "", "", "", "");
+                symbolTable.iCode(scanner.getToken().lineNumber, RTN);
         }
         scanner.fetchTokens();  //consume the closing "}"
     }
@@ -1079,7 +1106,7 @@ public:
             if (flagOfPass) {
                 currentMethodId = symbolTable.searchValue("g.main", "main");
                 if (currentMethodId == 0) unexpectedError("Cannot find main function symID");
-                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, symbolTable.getSymID(currentMethodId), "", "", symbolTable.getSymID(currentMethodId));
+                symbolTable.iCode(scanner.getToken().lineNumber, FUNC, opSym(currentMethodId), opNone(), opNone(), symbolTable.newLabel(symbolTable.getSymID(currentMethodId)));
                 methodOffset = 12;
             }
             currentClass = ".main";
@@ -1143,11 +1170,13 @@ public:
         }
         else {
             flagOfPass = true;
+            source = scanner.getSource();
+            sourceTokens = scanner.getTokens();
         }
     }
     
     void sa_iPush(Token token) {
-        SAR newSAR = {0, token.lineNumber, "id_sar", token.lexeme, "sa_iPush"};
+        SAR newSAR = {0, token.lineNumber, S_Id, symbolTable.intern(token.lexeme), "sa_iPush"};
         SAS.push(newSAR);
     }
     
@@ -1156,24 +1185,57 @@ public:
         if (tempId == 0) {
             semanticError(token.lineNumber, "Unexpected error in sa_lPush");
         }
-        SAR newSAR = {tempId, token.lineNumber, "lit_sar", token.lexeme, "sa_lPush"};
+        SAR newSAR = {tempId, token.lineNumber, S_Lit, symbolTable.intern(token.lexeme), "sa_lPush"};
         SAS.push(newSAR);
     }
     
+    // priority of an operator on OpStack, 0 for anything else
+    int operatorPriority(const std::string & op) {
+        if (op.size() == 1) {
+            switch (op[0]) {
+                case '*': case '/':
+                return 8;
+                case '+': case '-':
+                return 7;
+                case '<': case '>':
+                return 6;
+                case '=':
+                return 2;
+                case '(': case ')': case '[': case ']':
+                return 1;
+                default:
+                return 0;
+            }
+        }
+        if (op.size() == 2 && op[1] == '=') {
+            switch (op[0]) {
+                case '<': case '>':
+                return 6;
+                case '=': case '!':
+                return 5;
+                default:
+                return 0;
+            }
+        }
+        if (op == "&&") return 4;
+        if (op == "||") return 3;
+        return 0;
+    }
+    
     void sa_oPush(Token token) {
         if (token.lexeme == "(" || token.lexeme == "[") {
-            OpRec newOpRec = {token.lexeme, operatorTable[token.lexeme]};
+            OpRec newOpRec = {token.lexeme, operatorPriority(token.lexeme)};
             OpStack.push(newOpRec);
         }
         else {
             while (true) {
                 if (OpStack.empty()) {
-                    OpRec newOpRec = {token.lexeme, operatorTable[token.lexeme]};
+                    OpRec newOpRec = {token.lexeme, operatorPriority(token.lexeme)};
                     OpStack.push(newOpRec);
                     break;
                 }
-                else if (OpStack.top().priority < operatorTable[token.lexeme]) {
-                    OpRec newOpRec = {token.lexeme, operatorTable[token.lexeme]};
+                else if (OpStack.top().priority < operatorPriority(token.lexeme)) {
+                    OpRec newOpRec = {token.lexeme, operatorPriority(token.lexeme)};
                     OpStack.push(newOpRec);
                     break;
                 }
@@ -1223,11 +1285,11 @@ public:
     }
     
     void sa_tPush(Token token) {
-        SAR newSAR = {0, token.lineNumber, "type_sar", token.lexeme, "sa_tPush"};
+        SAR newSAR = {0, token.lineNumber, S_Type, symbolTable.intern(token.lexeme), "sa_tPush"};
         if (token.lexeme != "int" && token.lexeme != "bool" && token.lexeme != "char" && token.lexeme != "void" && token.lexeme != "sym") {
             // #tExist
             int tempId = symbolTable.searchValue("g", token.lexeme);
-            if (symbolTable.getKind(tempId) != "Class")
+            if (symbolTable.getKindCode(tempId) != K_Class)
                 semanticError(token.lineNumber, "Type \"" + token.lexeme + "\" not defined");
             else
                 newSAR.symID = tempId;
@@ -1242,42 +1304,30 @@ public:
         if (currentClass == ".main") {
             semanticError(token.lineNumber, "Variable \""  + token.lexeme + "\" not defined in \"main\"");
         }
-        SAR newSAR = {0, token.lineNumber, "this_sar", token.lexeme, "sa_thisPush"};
+        SAR newSAR = {0, token.lineNumber, S_This, symbolTable.intern(token.lexeme), "sa_thisPush"};
         SAS.push(newSAR);
     }
     
     void sa_iExist() {
         if (SAS.empty()) unexpectedError("SAS is empty -- #iExist");
-        if (SAS.top().reference == "id_sar") {
-            int tempId = 0;
-            std::string currentPath = "g" + currentClass + currentMethod;
-            while (currentPath != "g") {
-                tempId = symbolTable.searchValue(currentPath, SAS.top().value);
-                if (tempId != 0) break;
-                currentPath = currentPath.substr(0, currentPath.find_last_of('.'));
-            }
+        if (SAS.top().reference == S_Id) {
+            int tempId = symbolTable.searchScopeChain("g" + currentClass + currentMethod, symbolTable.getString(SAS.top().value));
             if (tempId != 0) {
-                SAR newSAR = {tempId, SAS.top().lineNumber, "id_sar", SAS.top().value, "sa_iExist"};
+                SAR newSAR = {tempId, SAS.top().lineNumber, S_Id, SAS.top().value, "sa_iExist"};
                 SAS.pop();
                 SAS.push(newSAR);
             }
             else {
-                semanticError(SAS.top().lineNumber, "Variable \"" + SAS.top().value + "\" not defined");
+                semanticError(SAS.top().lineNumber, "Variable \"" + symbolTable.getString(SAS.top().value) + "\" not defined");
             }
         }
-        else if (SAS.top().reference == "func_sar") {
-            int tempId = 0;
+        else if (SAS.top().reference == S_Func) {
             SAR topSAR = SAS.top();
-            std::string currentPath = "g" + currentClass + currentMethod;
-            std::string funcName = topSAR.value.substr(0, topSAR.value.find_first_of('('));
-            while (currentPath != "g") {
-                tempId = symbolTable.searchValue(currentPath, funcName);
-                if (tempId != 0) break;
-                currentPath = currentPath.substr(0, currentPath.find_last_of('.'));
-            }
+            std::string funcName = symbolTable.getString(topSAR.value).substr(0, symbolTable.getString(topSAR.value).find_first_of('('));
+            int tempId = symbolTable.searchScopeChain("g" + currentClass + currentMethod, funcName);
             std::vector<std::string> paramList;
-            std::string topSARparam = topSAR.value.substr(topSAR.value.find_first_of('('));
-            std::string topSARsignature = topSAR.value.substr(0, topSAR.value.find_first_of('('));
+            std::string topSARparam = symbolTable.getString(topSAR.value).substr(symbolTable.getString(topSAR.value).find_first_of('('));
+            std::string topSARsignature = symbolTable.getString(topSAR.value).substr(0, symbolTable.getString(topSAR.value).find_first_of('('));
             if (topSARparam.size() <= 2)
                 topSARsignature += "()";
             else {
@@ -1289,7 +1339,7 @@ public:
                 }
                 topSARsignature[topSARsignature.size() - 1] = ')';
             }
-            if (tempId != 0 && symbolTable.getKind(tempId) == "method") {
+            if (tempId != 0 && symbolTable.getKindCode(tempId) == K_Method) {
                 std::string funcSignature = symbolTable.getValue(tempId);
                 std::string paramStr = symbolTable.getParam(tempId);
                 if (paramStr.size() <= 2)
@@ -1310,17 +1360,17 @@ public:
                 else {
                     int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", symbolTable.getReturnType(tempId), "", "", "private", methodOffset);
                     methodOffset += 4;
-                    SAR newSAR = {newId, topSAR.lineNumber, "ref_sar", topSARsignature, "sa_iExist"};
+                    SAR newSAR = {newId, topSAR.lineNumber, S_Ref, symbolTable.intern(topSARsignature), "sa_iExist"};
                     SAS.pop();
                     SAS.push(newSAR);
 
-                    symbolTable.iCode(topSAR.lineNumber, FRAME, symbolTable.getSymID(tempId), "this", "", "");
+                    symbolTable.iCode(topSAR.lineNumber, FRAME, opSym(tempId), opThis());
                     for (int i = 0; i < paramList.size(); i++) {
-                        symbolTable.iCode(topSAR.lineNumber, PUSH, paramList[i], "", "", "");
+                        symbolTable.iCode(topSAR.lineNumber, PUSH, opSym(stoi(paramList[i].substr(1))));
                     }
-                    symbolTable.iCode(topSAR.lineNumber, CALL, symbolTable.getSymID(tempId), "", "", "");
+                    symbolTable.iCode(topSAR.lineNumber, CALL, opSym(tempId));
                     if (symbolTable.getReturnType(tempId) != "void") {
-                        symbolTable.iCode(topSAR.lineNumber, PEEK, symbolTable.getSymID(newId), "", "", "");
+                        symbolTable.iCode(topSAR.lineNumber, PEEK, opSym(newId));
                     }
                 }
             }
@@ -1328,29 +1378,23 @@ public:
                 semanticError(SAS.top().lineNumber, "Function \"" + topSARsignature + "\" not defined");
             }
         }
-        else if (SAS.top().reference == "arr_sar") {
-            int tempId = 0;
-            std::string currentPath = "g" + currentClass + currentMethod;
-            while (currentPath != "g") {
-                tempId = symbolTable.searchValue(currentPath, SAS.top().value);
-                if (tempId != 0) break;
-                currentPath = currentPath.substr(0, currentPath.find_last_of('.'));
-            }
+        else if (SAS.top().reference == S_Arr) {
+            int tempId = symbolTable.searchScopeChain("g" + currentClass + currentMethod, symbolTable.getString(SAS.top().value));
             if (tempId != 0 && symbolTable.getType(tempId).size() > 0 && symbolTable.getType(tempId)[0] == '@') {
                 int newId = symbolTable.insert("g" + currentClass + currentMethod, "R", "", "lvar", symbolTable.getType(tempId).substr(2), "", "", "private", methodOffset);
                 methodOffset += 4;
-                SAR newSAR = {newId, SAS.top().lineNumber, "id_sar", symbolTable.getSymID(newId), "sa_iExist"};
+                SAR newSAR = {newId, SAS.top().lineNumber, S_Id, symbolTable.intern(symbolTable.getSymID(newId)), "sa_iExist"};
                 //use SAS.top().symID to find the index of array
-                symbolTable.iCode(SAS.top().lineNumber, AEF, symbolTable.getSymID(tempId), symbolTable.getSymID(SAS.top().symID), symbolTable.getSymID(newId), "");
+                symbolTable.iCode(SAS.top().lineNumber, AEF, opSym(tempId), opSym(SAS.top().symID), opSym(newId));
                 SAS.pop();
                 SAS.push(newSAR);
             }
             else {
-                semanticError(SAS.top().lineNumber, "Array \"" + SAS.top().value + "\" not defined");
+                semanticError(SAS.top().lineNumber, "Array \"" + symbolTable.getString(SAS.top().value) + "\" not defined");
             }
         }
         else
-            semanticError(SAS.top().lineNumber, "unknown SAR " + SAS.top().value);
+            semanticError(SAS.top().lineNumber, "unknown SAR " + symbolTable.getString(SAS.top().value));
     }
     
     void sa_vPush(Token token) {
@@ -1358,7 +1402,7 @@ public:
         if (tempId == 0) {
             semanticError(token.lineNumber, "Unexpected error in sa_vPush");
         }
-        SAR newSAR = {tempId, token.lineNumber, "variable", token.lexeme, "sa_vPush"};
+        SAR newSAR = {tempId, token.lineNumber, S_Variable, symbolTable.intern(token.lexeme), "sa_vPush"};
         SAS.push(newSAR);
     }
     
@@ -1370,53 +1414,53 @@ public:
         SAR nextSAR = SAS.top();
         SAS.pop();
         
-        if (topSAR.reference == "id_sar") {
+        if (topSAR.reference == S_Id) {
             int classID = 0;
-            std::string refStr;
-            if (nextSAR.value == "this") {
+            OPERAND refOpr;
+            if (symbolTable.getString(nextSAR.value) == "this") {
                 classID = symbolTable.searchValue("g", currentClass.substr(1));
-                refStr = "this";
+                refOpr = opThis();
             }
             else {
                 classID = symbolTable.getClassIDFromObject(nextSAR.symID);
-                refStr = symbolTable.getSymID(nextSAR.symID);
+                refOpr = opSym(nextSAR.symID);
             }
             if (classID == 0) {
-                semanticError(topSAR.lineNumber, "Variable \""  + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+                semanticError(topSAR.lineNumber, "Variable \""  + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
-            int tempId = symbolTable.searchValue("g." + symbolTable.getValue(classID), topSAR.value);
-            if (tempId == 0 || symbolTable.getKind(tempId) != "ivar" ||
-                (nextSAR.value != "this" && symbolTable.getAccessMod(tempId) != "public")) {
-                semanticError(topSAR.lineNumber, "Variable \""  + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+            int tempId = symbolTable.searchValue("g." + symbolTable.getValue(classID), symbolTable.getString(topSAR.value));
+            if (tempId == 0 || symbolTable.getKindCode(tempId) != K_Ivar ||
+                (symbolTable.getString(nextSAR.value) != "this" && symbolTable.getAccessCode(tempId) != A_Public)) {
+                semanticError(topSAR.lineNumber, "Variable \""  + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
             else {
                 int newId = symbolTable.insert("g" + currentClass + currentMethod, "R", "", "lvar", symbolTable.getType(tempId), "", "", "private", methodOffset);
                 methodOffset += 4;
-                SAR newSAR = {newId, topSAR.lineNumber, "ref_sar", nextSAR.value + "." + topSAR.value, "sa_rExist"};
+                SAR newSAR = {newId, topSAR.lineNumber, S_Ref, symbolTable.intern(symbolTable.getString(nextSAR.value) + "." + symbolTable.getString(topSAR.value)), "sa_rExist"};
                 SAS.push(newSAR);
 
-                symbolTable.iCode(nextSAR.lineNumber, REF, refStr, symbolTable.getSymID(tempId), symbolTable.getSymID(newId), "");
+                symbolTable.iCode(nextSAR.lineNumber, REF, refOpr, opSym(tempId), opSym(newId));
             }
         }
-        else if (topSAR.reference == "func_sar") {
+        else if (topSAR.reference == S_Func) {
             int classID = 0;
-            std::string refStr;
-            if (nextSAR.value == "this") {
+            OPERAND refOpr;
+            if (symbolTable.getString(nextSAR.value) == "this") {
                 classID = symbolTable.searchValue("g", currentClass.substr(1));
-                refStr = "this";
+                refOpr = opThis();
             }
             else {
                 classID = symbolTable.getClassIDFromObject(nextSAR.symID);
-                refStr = symbolTable.getSymID(nextSAR.symID);
+                refOpr = opSym(nextSAR.symID);
             }
             if (classID == 0) {
-                semanticError(topSAR.lineNumber, "Function \""  + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+                semanticError(topSAR.lineNumber, "Function \""  + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
-            std::string funcName = topSAR.value.substr(0, topSAR.value.find_first_of('('));
+            std::string funcName = symbolTable.getString(topSAR.value).substr(0, symbolTable.getString(topSAR.value).find_first_of('('));
             int tempId = symbolTable.searchValue("g." + symbolTable.getValue(classID), funcName);
-            if (tempId == 0 || symbolTable.getKind(tempId) != "method" ||
-                (nextSAR.value != "this" && symbolTable.getAccessMod(tempId) != "public")) {
-                semanticError(topSAR.lineNumber, "Function \""  + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+            if (tempId == 0 || symbolTable.getKindCode(tempId) != K_Method ||
+                (symbolTable.getString(nextSAR.value) != "this" && symbolTable.getAccessCode(tempId) != A_Public)) {
+                semanticError(topSAR.lineNumber, "Function \""  + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
             std::string funcSignature = symbolTable.getValue(tempId);
             std::string paramStr = symbolTable.getParam(tempId);
@@ -1432,8 +1476,8 @@ public:
                 funcSignature[funcSignature.size() - 1] = ')';
             }
             std::vector<std::string> paramList;
-            std::string topSARparam = topSAR.value.substr(topSAR.value.find_first_of('('));
-            std::string topSARsignature = topSAR.value.substr(0, topSAR.value.find_first_of('('));
+            std::string topSARparam = symbolTable.getString(topSAR.value).substr(symbolTable.getString(topSAR.value).find_first_of('('));
+            std::string topSARsignature = symbolTable.getString(topSAR.value).substr(0, symbolTable.getString(topSAR.value).find_first_of('('));
             if (topSARparam.size() <= 2)
                 topSARsignature += "()";
             else {
@@ -1447,70 +1491,70 @@ public:
             }
             
             if (topSARsignature != funcSignature) {
-                semanticError(topSAR.lineNumber, "Function \""  + topSARsignature + "\" not defined/public in class \"" + nextSAR.value + "\"");
+                semanticError(topSAR.lineNumber, "Function \""  + topSARsignature + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
             else {
                 int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", symbolTable.getReturnType(tempId), "", "", "private", methodOffset);
                 methodOffset += 4;
-                SAR newSAR = {newId, topSAR.lineNumber, "ref_sar", nextSAR.value + "." + topSARsignature, "sa_rExist"};
+                SAR newSAR = {newId, topSAR.lineNumber, S_Ref, symbolTable.intern(symbolTable.getString(nextSAR.value) + "." + topSARsignature), "sa_rExist"};
                 SAS.push(newSAR);
 
-                symbolTable.iCode(nextSAR.lineNumber, FRAME, symbolTable.getSymID(tempId), refStr, "", "");
+                symbolTable.iCode(nextSAR.lineNumber, FRAME, opSym(tempId), refOpr);
                 for (int i = 0; i < paramList.size(); i++) {
-                    symbolTable.iCode(nextSAR.lineNumber, PUSH, paramList[i], "", "", "");
+                    symbolTable.iCode(nextSAR.lineNumber, PUSH, opSym(stoi(paramList[i].substr(1))));
                 }
-                symbolTable.iCode(nextSAR.lineNumber, CALL, symbolTable.getSymID(tempId), "", "", "");
+                symbolTable.iCode(nextSAR.lineNumber, CALL, opSym(tempId));
                 if (symbolTable.getReturnType(tempId) != "void") {
-                    symbolTable.iCode(nextSAR.lineNumber, PEEK, symbolTable.getSymID(newId), "", "", "");
+                    symbolTable.iCode(nextSAR.lineNumber, PEEK, opSym(newId));
                 }
             }
         }
-        else if (topSAR.reference == "arr_sar") {
+        else if (topSAR.reference == S_Arr) {
             int classID = 0;
-            std::string refStr;
-            if (nextSAR.value == "this") {
+            OPERAND refOpr;
+            if (symbolTable.getString(nextSAR.value) == "this") {
                 classID = symbolTable.searchValue("g", currentClass.substr(1));
-                refStr = "this";
+                refOpr = opThis();
             }
             else {
                 classID = symbolTable.getClassIDFromObject(nextSAR.symID);
-                refStr = symbolTable.getSymID(nextSAR.symID);
+                refOpr = opSym(nextSAR.symID);
             }
             if (classID == 0) {
-                semanticError(topSAR.lineNumber, "Array \""  + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+                semanticError(topSAR.lineNumber, "Array \""  + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
-            int tempId = symbolTable.searchValue("g." + symbolTable.getValue(classID), topSAR.value);
+            int tempId = symbolTable.searchValue("g." + symbolTable.getValue(classID), symbolTable.getString(topSAR.value));
             if (tempId == 0 || symbolTable.getType(tempId).size() == 0 || symbolTable.getType(tempId)[0] != '@' ||
-                (nextSAR.value != "this" && symbolTable.getAccessMod(tempId) != "public")) {
-                semanticError(topSAR.lineNumber, "Array \"" + topSAR.value + "\" not defined/public in class \"" + nextSAR.value + "\"");
+                (symbolTable.getString(nextSAR.value) != "this" && symbolTable.getAccessCode(tempId) != A_Public)) {
+                semanticError(topSAR.lineNumber, "Array \"" + symbolTable.getString(topSAR.value) + "\" not defined/public in class \"" + symbolTable.getString(nextSAR.value) + "\"");
             }
             else {
                 int refId = symbolTable.insert("g" + currentClass + currentMethod, "R", "", "tvar", symbolTable.getType(tempId), "", "", "private", methodOffset);
                 methodOffset += 4;
                 int newId = symbolTable.insert("g" + currentClass + currentMethod, "R", "", "lvar", symbolTable.getType(tempId).substr(2), "", "", "private", methodOffset);
                 methodOffset += 4;
-                SAR newSAR = {newId, topSAR.lineNumber, "id_sar", symbolTable.getSymID(newId), "sa_rExist"};
+                SAR newSAR = {newId, topSAR.lineNumber, S_Id, symbolTable.intern(symbolTable.getSymID(newId)), "sa_rExist"};
                 SAS.push(newSAR);
                 
-                symbolTable.iCode(nextSAR.lineNumber, REF, refStr, symbolTable.getSymID(tempId), symbolTable.getSymID(refId), "");
+                symbolTable.iCode(nextSAR.lineNumber, REF, refOpr, opSym(tempId), opSym(refId));
                 //use topSAR.symID to find the index of array
-                symbolTable.iCode(nextSAR.lineNumber, AEF, symbolTable.getSymID(refId), symbolTable.getSymID(topSAR.symID), symbolTable.getSymID(newId), "");
+                symbolTable.iCode(nextSAR.lineNumber, AEF, opSym(refId), opSym(topSAR.symID), opSym(newId));
             }
         }
         else
-            semanticError(topSAR.lineNumber, "unknown SAR " + topSAR.value);
+            semanticError(topSAR.lineNumber, "unknown SAR " + symbolTable.getString(topSAR.value));
     }
     
     
     void sa_BAL() {
-        SAR newSAR = {0, 0, "bal_sar", "", "sa_BAL"};
+        SAR newSAR = {0, 0, S_Bal, symbolTable.intern(""), "sa_BAL"};
         SAS.push(newSAR);
     }
     
     void sa_EAL() {
         std::string paramList = "(";
         std::stack<std::string> paramType;
-        while (!SAS.empty() && SAS.top().reference != "bal_sar") {
+        while (!SAS.empty() && SAS.top().reference != S_Bal) {
             paramType.push(symbolTable.getSymID(SAS.top().symID));
             SAS.pop();
         }
@@ -1527,7 +1571,7 @@ public:
             }
             paramList[paramList.size() - 1] = ')'; //substitute the last ',' to ')'
         }
-        SAR newSAR = {0, 0, "al_sar", paramList, "sa_EAL"};
+        SAR newSAR = {0, 0, S_Al, symbolTable.intern(paramList), "sa_EAL"};
         SAS.push(newSAR);
     }
     
@@ -1539,7 +1583,7 @@ public:
         SAR nextSAR = SAS.top();
         SAS.pop();
         
-        SAR newSAR = {0, nextSAR.lineNumber, "func_sar", nextSAR.value + alSAR.value, "sa_func"};
+        SAR newSAR = {0, nextSAR.lineNumber, S_Func, symbolTable.intern(symbolTable.getString(nextSAR.value) + symbolTable.getString(alSAR.value)), "sa_func"};
         SAS.push(newSAR);
     }
     
@@ -1555,28 +1599,28 @@ public:
             semanticError(idSAR.lineNumber, "Array requires int index got " + symbolTable.getType(arrIndex.symID));
         }
         
-        SAR newSAR = {arrIndex.symID, idSAR.lineNumber, "arr_sar", idSAR.value, "sa_arr"};
+        SAR newSAR = {arrIndex.symID, idSAR.lineNumber, S_Arr, idSAR.value, "sa_arr"};
         SAS.push(newSAR);
     }
     
-    void sa_if(std::string label, int line) {
+    void sa_if(int label, int line) {
         if (SAS.empty()){
             semanticError(line, "'if' requires 'bool' got \'" "\'");
         }
         if (symbolTable.getType(SAS.top().symID) == "bool") {
-            symbolTable.iCode(SAS.top().lineNumber, BF, symbolTable.getSymID(SAS.top().symID), label, "", "");
+            symbolTable.iCode(SAS.top().lineNumber, BF, opSym(SAS.top().symID), opLabel(label));
             SAS.pop();
         }
         else
             semanticError(SAS.top().lineNumber, "'if' requires 'bool' got \'" + symbolTable.getType(SAS.top().symID) + "\'");
     }
     
-    void sa_while(std::string label, int line) {
+    void sa_while(int label, int line) {
         if (SAS.empty()) {
             semanticError(SAS.top().lineNumber, "'while' requires 'bool' got \' \'");
         }
         if (symbolTable.getType(SAS.top().symID) == "bool") {
-            symbolTable.iCode(SAS.top().lineNumber, BF, symbolTable.getSymID(SAS.top().symID), label, "", "");
+            symbolTable.iCode(SAS.top().lineNumber, BF, opSym(SAS.top().symID), opLabel(label));
             SAS.pop();
         }
         else
@@ -1633,23 +1677,24 @@ public:
                     semanticError(0, "Unexpected Error on sa_return");
                 }
             }
-            std::string expressionType, symIdStr;
+            std::string expressionType;
+            OPERAND symIdOpr;
             if (SAS.empty()) {
                 unexpectedError("Unexpected empty SAS at sa_return");
             }
-            else if (SAS.top().value == "RTN") {
-                symbolTable.iCode(lineNumber, RTN, "", "", "", "");
+            else if (symbolTable.getString(SAS.top().value) == "RTN") {
+                symbolTable.iCode(lineNumber, RTN);
             }
             else {
-                if (SAS.top().value == "this") {
-                    symIdStr = "this";
+                if (symbolTable.getString(SAS.top().value) == "this") {
+                    symIdOpr = opThis();
                     expressionType = currentClass.substr(1);
                 }
                 else {
-                    symIdStr = symbolTable.getSymID(SAS.top().symID);
+                    symIdOpr = opSym(SAS.top().symID);
                     expressionType = symbolTable.getType(SAS.top().symID);
                 }
-                symbolTable.iCode(lineNumber, RETURN, symIdStr, "", "", "");
+                symbolTable.iCode(lineNumber, RETURN, symIdOpr);
                 if (expressionType != symbolTable.getReturnType(tempId)) {
                     semanticError(lineNumber, "Function requires \"" + symbolTable.getReturnType(tempId) + "\" returned \"" + expressionType + "\"");
                 }
@@ -1711,13 +1756,13 @@ public:
             expressionType = symbolTable.getType(SAS.top().symID);
         }
         if (expressionType == "char") {
-            symbolTable.iCode(SAS.top().lineNumber, WRTC, symbolTable.getSymID(SAS.top().symID), "", "", "");
+            symbolTable.iCode(SAS.top().lineNumber, WRTC, opSym(SAS.top().symID));
         }
         else if (expressionType == "int") {
-            symbolTable.iCode(SAS.top().lineNumber, WRTI, symbolTable.getSymID(SAS.top().symID), "", "", "");
+            symbolTable.iCode(SAS.top().lineNumber, WRTI, opSym(SAS.top().symID));
         }
         else if (expressionType == "bool") {
-            symbolTable.iCode(SAS.top().lineNumber, WRITE, symbolTable.getSymID(SAS.top().symID), "", "", "");
+            symbolTable.iCode(SAS.top().lineNumber, WRITE, opSym(SAS.top().symID));
         }
         else
             semanticError(lineNumber, "cout not defined for " + expressionType);
@@ -1779,10 +1824,10 @@ public:
         if ((expressionType == "char" || expressionType == "int") &&
             !SAS.empty() && isLValue(SAS.top().symID)) {
             if (expressionType == "char") {
-                symbolTable.iCode(SAS.top().lineNumber, RDC, symbolTable.getSymID(SAS.top().symID), "", "", "");
+                symbolTable.iCode(SAS.top().lineNumber, RDC, opSym(SAS.top().symID));
             }
             else if (expressionType == "int") {
-                symbolTable.iCode(SAS.top().lineNumber, RDI, symbolTable.getSymID(SAS.top().symID), "", "", "");
+                symbolTable.iCode(SAS.top().lineNumber, RDI, opSym(SAS.top().symID));
             }
         }
         else
@@ -1790,6 +1835,69 @@ public:
         while (!SAS.empty()) SAS.pop();
     }
     
+    // delete of an object or an array gives its memory back to the heap, delete null does nothing
+    void sa_delete(int lineNumber) {
+        while (!OpStack.empty()) {
+            if (OpStack.top().value == "=") {
+                sa_AssigmentOperator();
+            }
+            else if (OpStack.top().value == "&&") {
+                sa_AndOperator();
+            }
+            else if (OpStack.top().value == "||") {
+                sa_OrOperator();
+            }
+            else if (OpStack.top().value == "==") {
+                sa_EqualOperator();
+            }
+            else if (OpStack.top().value == "!=") {
+                sa_NotEqualOperator();
+            }
+            else if (OpStack.top().value == "<=") {
+                sa_LessEqualOperator();
+            }
+            else if (OpStack.top().value == ">=") {
+                sa_GreaterEqualOperator();
+            }
+            else if (OpStack.top().value == "<") {
+                sa_LessThanOperator();
+            }
+            else if (OpStack.top().value == ">") {
+                sa_GreaterThanOperator();
+            }
+            else if (OpStack.top().value == "+") {
+                sa_AddOperator();
+            }
+            else if (OpStack.top().value == "-") {
+                sa_SubtractOperator();
+            }
+            else if (OpStack.top().value == "*") {
+                sa_MultiplyOperator();
+            }
+            else if (OpStack.top().value == "/") {
+                sa_DivideOperator();
+            }
+            else {
+                semanticError(0, "Unexpected Error on sa_delete");
+            }
+        }
+        std::string expressionType;
+        if (SAS.empty()) {
+            expressionType = "void";
+        }
+        else {
+            expressionType = symbolTable.getType(SAS.top().symID);
+        }
+        int classId = symbolTable.searchValue("g", expressionType);
+        if (expressionType.substr(0, 2) == "@:" || expressionType == "null" ||
+            (classId != 0 && symbolTable.getKindCode(classId) == K_Class)) {
+            symbolTable.iCode(SAS.top().lineNumber, DELETE, opSym(SAS.top().symID));
+        }
+        else
+            semanticError(lineNumber, "delete not defined for " + expressionType);
+        while (!SAS.empty()) SAS.pop();
+    }
+    
     void sa_newObj() {
         if (SAS.empty()) unexpectedError("SAS is empty -- #sa_newObj");
         SAR alSAR = SAS.top();
@@ -1798,15 +1906,15 @@ public:
         SAR typeSAR = SAS.top();
         SAS.pop();
         
-        int tempId = symbolTable.searchValue("g." + typeSAR.value, typeSAR.value);
-        if (tempId == 0 || symbolTable.getKind(tempId) != "Constructor" || symbolTable.getAccessMod(tempId) != "public") {
-            semanticError(typeSAR.lineNumber, "Constructor \""  + typeSAR.value + alSAR.value + "\" not defined");
+        int tempId = symbolTable.searchValue("g." + symbolTable.getString(typeSAR.value), symbolTable.getString(typeSAR.value));
+        if (tempId == 0 || symbolTable.getKindCode(tempId) != K_Constructor || symbolTable.getAccessCode(tempId) != A_Public) {
+            semanticError(typeSAR.lineNumber, "Constructor \""  + symbolTable.getString(typeSAR.value) + symbolTable.getString(alSAR.value) + "\" not defined");
         }
-        std::string funcSignature = typeSAR.value;
+        std::string funcSignature = symbolTable.getString(typeSAR.value);
         std::string paramStr = symbolTable.getParam(tempId);
-        int classId = symbolTable.searchValue("g", typeSAR.value);
-        if (classId == 0 || symbolTable.getKind(classId) != "Class") {
-            semanticError(typeSAR.lineNumber, "Constructor \""  + typeSAR.value + alSAR.value + "\" not related to a class");
+        int classId = symbolTable.searchValue("g", symbolTable.getString(typeSAR.value));
+        if (classId == 0 || symbolTable.getKindCode(classId) != K_Class) {
+            semanticError(typeSAR.lineNumber, "Constructor \""  + symbolTable.getString(typeSAR.value) + symbolTable.getString(alSAR.value) + "\" not related to a class");
         }
         int classSize = symbolTable.getOffset(classId);
 
@@ -1822,8 +1930,8 @@ public:
             funcSignature[funcSignature.size() - 1] = ')';
         }
         std::vector<std::string> paramList;
-        std::string topSARparam = alSAR.value;
-        std::string topSARsignature = typeSAR.value;
+        std::string topSARparam = symbolTable.getString(alSAR.value);
+        std::string topSARsignature = symbolTable.getString(typeSAR.value);
         if (topSARparam.size() <= 2)
             topSARsignature += "()";
         else {
@@ -1840,21 +1948,21 @@ public:
             semanticError(typeSAR.lineNumber, "Constructor \""  + topSARsignature + "\" not defined");
         }
         else {
-            int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", typeSAR.value, "", "", "private", methodOffset);
+            int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", symbolTable.getString(typeSAR.value), "", "", "private", methodOffset);
             methodOffset += 4;
-            int returnId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "lval", typeSAR.value, "", "", "private", methodOffset);
+            int returnId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "lval", symbolTable.getString(typeSAR.value), "", "", "private", methodOffset);
             methodOffset +=4;
-            SAR newSAR = {returnId, typeSAR.lineNumber, "new_sar", topSARsignature, "sa_newObj"};
+            SAR newSAR = {returnId, typeSAR.lineNumber, S_New, symbolTable.intern(topSARsignature), "sa_newObj"};
             SAS.push(newSAR);
             
-            int methodId = symbolTable.searchValue("g." + typeSAR.value, typeSAR.value);
-            symbolTable.iCode(typeSAR.lineNumber, NEWI, std::to_string(classSize), symbolTable.getSymID(newId), "", "");
-            symbolTable.iCode(typeSAR.lineNumber, FRAME, symbolTable.getSymID(methodId), symbolTable.getSymID(newId), "", "");
+            int methodId = symbolTable.searchValue("g." + symbolTable.getString(typeSAR.value), symbolTable.getString(typeSAR.value));
+            symbolTable.iCode(typeSAR.lineNumber, NEWI, opImm(classSize), opSym(newId));
+            symbolTable.iCode(typeSAR.lineNumber, FRAME, opSym(methodId), opSym(newId));
             for (int i = 0; i < paramList.size(); i++) {
-                symbolTable.iCode(typeSAR.lineNumber, PUSH, paramList[i], "", "", "");
+                symbolTable.iCode(typeSAR.lineNumber, PUSH, opSym(stoi(paramList[i].substr(1))));
             }
-            symbolTable.iCode(typeSAR.lineNumber, CALL, symbolTable.getSymID(methodId), "", "", "");
-            symbolTable.iCode(typeSAR.lineNumber, PEEK, symbolTable.getSymID(returnId), "" ,"" , "");
+            symbolTable.iCode(typeSAR.lineNumber, CALL, opSym(methodId));
+            symbolTable.iCode(typeSAR.lineNumber, PEEK, opSym(returnId));
         }
     }
     
@@ -1870,24 +1978,24 @@ public:
             semanticError(typeSAR.lineNumber, "Array requires int index got " + symbolTable.getType(arrIndex.symID));
         }
         
-        if (typeSAR.value == "int" || typeSAR.value == "bool" || typeSAR.value == "char" || symbolTable.searchValue("g", typeSAR.value) != 0) {
+        if (symbolTable.getString(typeSAR.value) == "int" || symbolTable.getString(typeSAR.value) == "bool" || symbolTable.getString(typeSAR.value) == "char" || symbolTable.searchValue("g", symbolTable.getString(typeSAR.value)) != 0) {
             int indexSize = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "int", "", "", "private", methodOffset);
             methodOffset += 4;
-            int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "@:" + typeSAR.value, "", "", "private", methodOffset);
+            int newId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "@:" + symbolTable.getString(typeSAR.value), "", "", "private", methodOffset);
             methodOffset += 4;
-            SAR newSAR = {newId, typeSAR.lineNumber, "new_sar", "", "sa_newArray"};
+            SAR newSAR = {newId, typeSAR.lineNumber, S_New, symbolTable.intern(""), "sa_newArray"};
             SAS.push(newSAR);
             
             int sizeId = 0;
-            if (typeSAR.value == "char")
+            if (symbolTable.getString(typeSAR.value) == "char")
                 sizeId = symbolTable.searchValue("g", "1");
             else
                 sizeId = symbolTable.searchValue("g", "4");
-            symbolTable.iCode(typeSAR.lineNumber, MUL, symbolTable.getSymID(sizeId), symbolTable.getSymID(arrIndex.symID), symbolTable.getSymID(indexSize), "");
-            symbolTable.iCode(typeSAR.lineNumber, NEW, symbolTable.getSymID(indexSize), symbolTable.getSymID(newId), "", "");
+            symbolTable.iCode(typeSAR.lineNumber, MUL, opSym(sizeId), opSym(arrIndex.symID), opSym(indexSize));
+            symbolTable.iCode(typeSAR.lineNumber, NEW, opSym(indexSize), opSym(newId));
         }
         else {
-            semanticError(typeSAR.lineNumber, "Type \""  + typeSAR.value + "\" not defined");
+            semanticError(typeSAR.lineNumber, "Type \""  + symbolTable.getString(typeSAR.value) + "\" not defined");
         }
     }
     
@@ -2113,18 +2221,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "int", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Add"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Add"};
             SAS.push(newSAR);
 
-            symbolTable.iCode(exp1.lineNumber, ADD, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, ADD, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " + "
+                          + symbolTable.getString(exp1.value) + " + "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2147,18 +2255,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "int", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Subtract"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Subtract"};
             SAS.push(newSAR);
  
-            symbolTable.iCode(exp1.lineNumber, SUB, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, SUB, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " - "
+                          + symbolTable.getString(exp1.value) + " - "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2181,18 +2289,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "int", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Multiply"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Multiply"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, MUL, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, MUL, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " * "
+                          + symbolTable.getString(exp1.value) + " * "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2215,18 +2323,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "int", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Divide"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Divide"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, DIV, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, DIV, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " / "
+                          + symbolTable.getString(exp1.value) + " / "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2248,15 +2356,15 @@ public:
             (symbolTable.getType(exp1.symID) == symbolTable.getType(exp2.symID) || (symbolTable.getType(exp2.symID) == "null"))) {
             OpStack.pop();
             
-            symbolTable.iCode(exp1.lineNumber, MOV, symbolTable.getSymID(exp2.symID), symbolTable.getSymID(exp1.symID), "", "");
+            symbolTable.iCode(exp1.lineNumber, MOV, opSym(exp2.symID), opSym(exp1.symID));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " = "
+                          + symbolTable.getString(exp1.value) + " = "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2280,18 +2388,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Less"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Less"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, LT, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, LT, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " < "
+                          + symbolTable.getString(exp1.value) + " < "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2315,18 +2423,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Greater"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Greater"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, GT, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, GT, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " > "
+                          + symbolTable.getString(exp1.value) + " > "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2349,18 +2457,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Equal"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Equal"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, EQ, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, EQ, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " == "
+                          + symbolTable.getString(exp1.value) + " == "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
 
     }
@@ -2385,18 +2493,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_LessEqual"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_LessEqual"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, LE, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, LE, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " <= "
+                          + symbolTable.getString(exp1.value) + " <= "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2420,18 +2528,18 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_GreaterEqual"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_GreaterEqual"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, GE, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, GE, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " >= "
+                          + symbolTable.getString(exp1.value) + " >= "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
@@ -2455,10 +2563,10 @@ public:
                 int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
                 methodOffset += 4;
                 symbolTable.updateName(tempId);
-                SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_And"};
+                SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_And"};
                 SAS.push(newSAR);
                 
-                symbolTable.iCode(exp1.lineNumber, AND, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+                symbolTable.iCode(exp1.lineNumber, AND, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
             }
             else {
                 semanticError(exp2.lineNumber, "And requires bool found " + symbolTable.getType(exp2.symID));
@@ -2489,10 +2597,10 @@ public:
                 int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
                 methodOffset += 4;
                 symbolTable.updateName(tempId);
-                SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Or"};
+                SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Or"};
                 SAS.push(newSAR);
                 
-                symbolTable.iCode(exp1.lineNumber, OR, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+                symbolTable.iCode(exp1.lineNumber, OR, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
             }
             else {
                 semanticError(exp2.lineNumber, "Or requires bool found " + symbolTable.getType(exp2.symID));
@@ -2522,27 +2630,27 @@ public:
             int tempId = symbolTable.insert("g" + currentClass + currentMethod, "T", "", "tvar", "bool", "", "", "private", methodOffset);
             methodOffset += 4;
             symbolTable.updateName(tempId);
-            SAR newSAR = {tempId, exp1.lineNumber, "tvar_sar", symbolTable.getValue(tempId), "sa_Less"};
+            SAR newSAR = {tempId, exp1.lineNumber, S_Tvar, symbolTable.intern(symbolTable.getValue(tempId)), "sa_Less"};
             SAS.push(newSAR);
             
-            symbolTable.iCode(exp1.lineNumber, NE, symbolTable.getSymID(exp1.symID), symbolTable.getSymID(exp2.symID), symbolTable.getSymID(tempId), "");
+            symbolTable.iCode(exp1.lineNumber, NE, opSym(exp1.symID), opSym(exp2.symID), opSym(tempId));
         }
         else {
             semanticError(exp2.lineNumber,
                           "Invalid Operation "
                           + symbolTable.getType(exp1.symID) + " "
-                          + exp1.value + " != "
+                          + symbolTable.getString(exp1.value) + " != "
                           + symbolTable.getType(exp2.symID) + " "
-                          + exp2.value);
+                          + symbolTable.getString(exp2.value));
         }
     }
     
     bool isLValue(int sid) {
-        return symbolTable.getKind(sid) == "ivar" || symbolTable.getKind(sid) == "lvar" || symbolTable.getKind(sid) == "param";
+        return symbolTable.getKindCode(sid) == K_Ivar || symbolTable.getKindCode(sid) == K_Lvar || symbolTable.getKindCode(sid) == K_Param;
     }
     
     void semanticAnalysis() {
-        Scanner scanner(sourceCodeFilename);
+        Scanner scanner(source, sourceTokens);
         scanner.fetchTokens();  // fetch a token to nextToken
         scanner.fetchTokens();  // fetch a token to currentToken and nextToken
         compiliation_unit(scanner);
@@ -2550,13 +2658,35 @@ public:
     }
     
     void run() {
+        run("tcode.asm");
+    }
+    
+    // an empty targetFilename keeps the target code in memory only, see getTargetCode()
+    void run(std::string targetFilename) {
 //        lexicalAnalysis();
         syntaxAnalysis();
         semanticAnalysis();
 //        symbolTable.printAll();
 //        symbolTable.printAllICode();
+        Optimizer(symbolTable).run(optimizationLevel);
+        RegisterAllocator(symbolTable).run(optimizationLevel);
         symbolTable.generateTCode();
-        std::cout << "Success to compile kxi code to \"tcode.asm\" file\n";
+        std::string peepholeReport = "";
+        if (peephole) {
+            PeepholeOptimizer peepholeOptimizer(symbolTable.getTCode());
+            peepholeOptimizer.run();
+            peepholeReport = peepholeOptimizer.report();
+        }
+        if (targetFilename != "") {
+            symbolTable.saveTCodeTofile(targetFilename);
+            std::cout << "Success to compile kxi code to \"" << targetFilename << "\" file\n";
+            if (peephole) std::cout << "Peephole optimizer: " << peepholeReport << "\n";
+        }
+    }
+    
+    // target code as the VM assembler's token lines
+    std::vector<std::vector<std::string>> getTargetCode() {
+        return symbolTable.getTokenizedTCode();
     }
 };
 
@@ -0,0 +1,129 @@
+//
+//  ICode.hpp
+//  compiler
+//
+
+#ifndef ICode_hpp
+#define ICode_hpp
+
+enum ICODEOP {
+    ADD,
+    ADI,
+    SUB,
+    MUL,
+    DIV,
+    LT,
+    GT,
+    NE,
+    EQ,
+    LE,
+    GE,
+    AND,
+    OR,
+    BF,
+    BT,
+    JMP,
+    PUSH,
+    POP,
+    PEEK,
+    FRAME,
+    CALL,
+    RTN,
+    RETURN,
+    FUNC,
+    NEWI,
+    NEW,
+    DELETE,
+    MOV,
+    MOVI,
+    WRITE,
+    READ,
+    WRTC,
+    WRTI,
+    RDC,
+    RDI,
+    REF,
+    AEF,
+    STOP,
+    NOP
+};
+
+enum OperandKind {
+    O_None,
+    O_Sym,    // value is a symbol id
+    O_Imm,    // value is the number itself
+    O_Label,  // value is a label id from SymTable::newLabel
+    O_This,
+    O_Null
+};
+
+struct OPERAND {
+    OperandKind kind;
+    int value;
+};
+
+inline OPERAND opNone() { return { O_None, 0 }; }
+inline OPERAND opSym(int id) { return { O_Sym, id }; }
+inline OPERAND opImm(int value) { return { O_Imm, value }; }
+inline OPERAND opLabel(int label) { return { O_Label, label }; }
+inline OPERAND opThis() { return { O_This, 0 }; }
+inline OPERAND opNull() { return { O_Null, 0 }; }
+
+// label is a label id from SymTable::newLabel, 0 is no label
+struct QUAD {
+    int lineNumber;
+    ICODEOP opcode;
+    OPERAND operand1;
+    OPERAND operand2;
+    OPERAND operand3;
+    int label;
+};
+
+inline bool isBinaryICode(ICODEOP op) {
+    switch (op) {
+        case ADD: case SUB: case MUL: case DIV: case AND: case OR:
+        case LT: case GT: case NE: case EQ: case LE: case GE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline bool isRelationalICode(ICODEOP op) {
+    switch (op) {
+        case LT: case GT: case NE: case EQ: case LE: case GE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// which operands (0-2) a quad reads as values and which one it writes, -1 for none
+inline bool iCodeReads(ICODEOP op, int k) {
+    if (isBinaryICode(op)) return k < 2;
+    switch (op) {
+        case MOV: case BF: case PUSH: case WRITE: case WRTC: case WRTI:
+        case RETURN: case NEW: case DELETE: case REF:
+            return k == 0;
+        case AEF:
+            return k < 2;
+        case FRAME:
+            return k == 1;
+        default:
+            return false;
+    }
+}
+
+inline int iCodeWrites(ICODEOP op) {
+    if (isBinaryICode(op)) return 2;
+    switch (op) {
+        case MOV: case NEW: case NEWI:
+            return 1;
+        case PEEK: case RDC: case RDI:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+#endif /* ICode_hpp */
@@ -0,0 +1,719 @@
+//
+//  Optimizer.hpp
+//  compiler
+//
+
+#ifndef Optimizer_hpp
+#define Optimizer_hpp
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <climits>
+#include <cstdlib>
+#include "SymTable.hpp"
+
+#define OPT_MAX_ROUNDS 4  // propagate + eliminate rounds before giving up on a fixed point
+
+enum LatticeState {
+    L_Top,     // no definition seen yet
+    L_Const,
+    L_Bottom   // not a constant
+};
+
+// one SSA definition of a local, parameter or temporary
+struct SSAValue {
+    int var;          // index into Optimizer::varSym
+    int defQuad;      // quad that defines it, -1 for a phi or the function entry
+    int phiBlock;     // block holding the phi, -1 if it is not a phi
+    LatticeState state;
+    int constant;
+    int copyOf;       // value this one is a plain MOV of, -1 if none
+    std::vector<int> quadUsers;
+    std::vector<int> phiUsers;
+    std::vector<int> phiArgs;  // for a phi, one value per entry of preds[phiBlock]
+};
+
+// SSA middle end run between semantic analysis and generateTCode.
+// Locals, parameters and temporaries are never aliased (KXI has no address-of,
+// REF/AEF only point into the heap), so they are put in SSA form; ivars and the
+// R reference variables are memory and left alone. SSA is used for analysis
+// only: results are written back into the quads in place, so no phi copies or
+// new frame slots are needed.
+//   -O1: sparse conditional constant propagation, copy propagation, branch
+//        folding, unreachable code and dead code elimination, and writing
+//        results straight into the variable a temporary is only copied to
+//   -O2: also keeps locals and temporaries in registers, see RegisterAllocator
+class Optimizer {
+private:
+    SymTable & symbolTable;
+    std::vector<QUAD> & quad;
+
+    // variables in SSA form
+    std::vector<int> varSym;  // var index -> symbol id
+    std::vector<int> varOf;   // symbol id - SYMID_START -> var index, -1 if not a variable
+
+    // graph, block blockCount is the virtual root in front of every function entry
+    int blockCount = 0;
+    std::vector<int> blockOf;  // quad -> block
+    std::vector<std::vector<int>> preds;
+    std::vector<std::vector<int>> succs;
+    std::vector<int> rpoIndex;  // -1 if unreachable from the root
+    std::vector<int> idom;
+    std::vector<std::vector<int>> domChildren;
+
+    // SSA form
+    std::vector<SSAValue> values;
+    std::vector<int> entryValue;  // var -> value it has on function entry
+    std::vector<std::vector<int>> phis;  // block -> phi values
+    std::vector<int> useValue;  // quad * 3 + operand -> value read there, -1 if none
+    std::vector<int> defValue;  // quad -> value defined there, -1 if none
+    std::vector<std::vector<int>> versions;  // var -> renaming stack
+    std::vector<int> pushedVars;
+
+    // SCCP
+    std::vector<bool> blockExecutable;
+    std::unordered_set<long long> edgeExecutable;
+    std::vector<std::pair<int, int>> flowWork;
+    std::vector<int> ssaWork;
+
+    bool isVariable(OPERAND opr) {
+        return opr.kind == O_Sym && symbolTable.isValidID(opr.value) && varOf[opr.value - SYMID_START] >= 0;
+    }
+
+    int varIndex(OPERAND opr) {
+        return varOf[opr.value - SYMID_START];
+    }
+
+    static OPERAND & operandAt(QUAD & code, int k) {
+        return k == 0 ? code.operand1 : (k == 1 ? code.operand2 : code.operand3);
+    }
+
+    bool literalValue(OPERAND opr, int & result) {
+        if (opr.kind != O_Sym) return false;
+        if (opr.value == symbolTable.getTrueID()) { result = 1; return true; }
+        if (opr.value == symbolTable.getFalseID()) { result = 0; return true; }
+        if (symbolTable.getKindCode(opr.value) == K_Ilit) {
+            result = static_cast<int>(std::strtoll(symbolTable.getValue(opr.value).c_str(), nullptr, 10));
+            return true;
+        }
+        if (symbolTable.getKindCode(opr.value) == K_Clit) {
+            result = symbolTable.getASCIIcode(symbolTable.getValue(opr.value));
+            return true;
+        }
+        return false;
+    }
+
+    // literal symbol holding value as the type of symbol id, 0 if there is none
+    int literalFor(int value, int id) {
+        switch (symbolTable.getTypeCode(id)) {
+            case Y_Int:
+                return symbolTable.intLiteral(value);
+            case Y_Bool:
+                return value != 0 ? symbolTable.getTrueID() : symbolTable.getFalseID();
+            case Y_Char:
+            {
+                std::string lexeme = value == 10 ? "'\\n'" : std::string("'") + static_cast<char>(value) + "'";
+                int tempId = symbolTable.searchValue("g", lexeme);
+                return symbolTable.getKindCode(tempId) == K_Clit ? tempId : 0;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    // same arithmetic as the VM, false if it cannot be done at compile time
+    static bool fold(ICODEOP op, int a, int b, int & result) {
+        int difference = static_cast<int>(static_cast<unsigned int>(a) - static_cast<unsigned int>(b));  // CMP
+        switch (op) {
+            case ADD: result = static_cast<int>(static_cast<unsigned int>(a) + static_cast<unsigned int>(b)); return true;
+            case SUB: result = difference; return true;
+            case MUL: result = static_cast<int>(static_cast<unsigned int>(a) * static_cast<unsigned int>(b)); return true;
+            case DIV:
+                if (b == 0 || (a == INT_MIN && b == -1)) return false;
+                result = a / b;
+                return true;
+            case AND: result = (a == 0 || b == 0) ? 0 : 1; return true;
+            case OR: result = (a == 0 && b == 0) ? 0 : 1; return true;
+            case LT: result = difference < 0; return true;
+            case GT: result = difference > 0; return true;
+            case NE: result = difference != 0; return true;
+            case EQ: result = difference == 0; return true;
+            case LE: result = !(difference > 0); return true;
+            case GE: result = !(difference < 0); return true;
+            default: return false;
+        }
+    }
+
+    // ---- graph ----
+
+    void buildGraph() {
+        symbolTable.buildCFG();
+        CFG & cfg = symbolTable.getCFG();
+        blockCount = cfg.size();
+        int root = blockCount;
+        blockOf.assign(quad.size(), 0);
+        preds.assign(blockCount + 1, std::vector<int>());
+        succs.assign(blockCount + 1, std::vector<int>());
+        for (int b = 0; b < blockCount; b++) {
+            BasicBlock & block = cfg.getBlock(b);
+            for (int i = block.first; i < block.last; i++) blockOf[i] = b;
+            succs[b] = block.successors;
+            if (b == 0 || quad[block.first].opcode == FUNC) succs[root].push_back(b);
+        }
+
+        // reverse postorder from the root
+        std::vector<int> postorder;
+        std::vector<int> visit(blockCount + 1, 0);
+        std::vector<std::pair<int, int>> stack;
+        stack.push_back({ root, 0 });
+        visit[root] = 1;
+        while (!stack.empty()) {
+            int b = stack.back().first;
+            if (stack.back().second < static_cast<int>(succs[b].size())) {
+                int s = succs[b][stack.back().second++];
+                if (!visit[s]) {
+                    visit[s] = 1;
+                    stack.push_back({ s, 0 });
+                }
+            }
+            else {
+                postorder.push_back(b);
+                stack.pop_back();
+            }
+        }
+        rpoIndex.assign(blockCount + 1, -1);
+        std::vector<int> rpo(postorder.rbegin(), postorder.rend());
+        for (int i = 0; i < static_cast<int>(rpo.size()); i++) rpoIndex[rpo[i]] = i;
+        for (int i = 0; i < static_cast<int>(rpo.size()); i++) {
+            for (int j = 0; j < static_cast<int>(succs[rpo[i]].size()); j++) preds[succs[rpo[i]][j]].push_back(rpo[i]);
+        }
+
+        // dominators, Cooper, Harvey and Kennedy
+        idom.assign(blockCount + 1, -1);
+        idom[root] = root;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int i = 1; i < static_cast<int>(rpo.size()); i++) {
+                int b = rpo[i];
+                int newIdom = -1;
+                for (int j = 0; j < static_cast<int>(preds[b].size()); j++) {
+                    int p = preds[b][j];
+                    if (idom[p] < 0) continue;
+                    if (newIdom < 0) {
+                        newIdom = p;
+                        continue;
+                    }
+                    int x = p, y = newIdom;
+                    while (x != y) {
+                        while (rpoIndex[x] > rpoIndex[y]) x = idom[x];
+                        while (rpoIndex[y] > rpoIndex[x]) y = idom[y];
+                    }
+                    newIdom = x;
+                }
+                if (idom[b] != newIdom) {
+                    idom[b] = newIdom;
+                    changed = true;
+                }
+            }
+        }
+        domChildren.assign(blockCount + 1, std::vector<int>());
+        for (int i = 1; i < static_cast<int>(rpo.size()); i++) domChildren[idom[rpo[i]]].push_back(rpo[i]);
+    }
+
+    // ---- SSA construction ----
+
+    int newValue(int var, int defQuad, int phiBlock) {
+        values.push_back({ var, defQuad, phiBlock, L_Top, 0, -1, {}, {}, {} });
+        return static_cast<int>(values.size()) - 1;
+    }
+
+    int currentVersion(int var) {
+        return versions[var].empty() ? entryValue[var] : versions[var].back();
+    }
+
+    void pushVersion(int var, int value) {
+        versions[var].push_back(value);
+        pushedVars.push_back(var);
+    }
+
+    void buildSSA() {
+        varOf.assign(symbolTable.getSymbolCount(), -1);
+        varSym.clear();
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            for (int k = 0; k < 3; k++) {
+                OPERAND opr = operandAt(quad[i], k);
+                if (opr.kind != O_Sym || !symbolTable.isValidID(opr.value) || varOf[opr.value - SYMID_START] >= 0) continue;
+                SymKind kind = symbolTable.getKindCode(opr.value);
+                if ((kind == K_Lvar || kind == K_Param || kind == K_Tvar || kind == K_Lval) && symbolTable.getIDType(opr.value) != 'R') {
+                    varOf[opr.value - SYMID_START] = static_cast<int>(varSym.size());
+                    varSym.push_back(opr.value);
+                }
+            }
+        }
+        int varCount = static_cast<int>(varSym.size());
+
+        values.clear();
+        entryValue.assign(varCount, -1);
+        for (int v = 0; v < varCount; v++) {
+            entryValue[v] = newValue(v, -1, -1);
+            values[entryValue[v]].state = L_Bottom;
+        }
+
+        // phis only for variables live across a block boundary (semi-pruned SSA)
+        std::vector<std::vector<int>> defBlocks(varCount);
+        std::vector<bool> global(varCount, false);
+        std::vector<int> killedIn(varCount, -1);
+        for (int b = 0; b < blockCount; b++) {
+            if (rpoIndex[b] < 0) continue;
+            BasicBlock & block = symbolTable.getCFG().getBlock(b);
+            for (int i = block.first; i < block.last; i++) {
+                for (int k = 0; k < 3; k++) {
+                    OPERAND opr = operandAt(quad[i], k);
+                    if (iCodeReads(quad[i].opcode, k) && isVariable(opr) && killedIn[varIndex(opr)] != b) global[varIndex(opr)] = true;
+                }
+                int w = iCodeWrites(quad[i].opcode);
+                if (w >= 0 && isVariable(operandAt(quad[i], w))) {
+                    int var = varIndex(operandAt(quad[i], w));
+                    if (killedIn[var] != b) defBlocks[var].push_back(b);
+                    killedIn[var] = b;
+                }
+            }
+        }
+
+        std::vector<std::vector<int>> frontier(blockCount + 1);
+        for (int b = 0; b < blockCount; b++) {
+            if (rpoIndex[b] < 0 || preds[b].size() < 2) continue;
+            for (int j = 0; j < static_cast<int>(preds[b].size()); j++) {
+                for (int runner = preds[b][j]; runner != idom[b]; runner = idom[runner]) {
+                    if (frontier[runner].empty() || frontier[runner].back() != b) frontier[runner].push_back(b);
+                }
+            }
+        }
+
+        phis.assign(blockCount + 1, std::vector<int>());
+        std::vector<int> hasPhi(blockCount + 1, -1), queued(blockCount + 1, -1);
+        for (int v = 0; v < varCount; v++) {
+            if (!global[v]) continue;
+            std::vector<int> work = defBlocks[v];
+            for (int i = 0; i < static_cast<int>(work.size()); i++) queued[work[i]] = v;
+            while (!work.empty()) {
+                int b = work.back();
+                work.pop_back();
+                for (int j = 0; j < static_cast<int>(frontier[b].size()); j++) {
+                    int d = frontier[b][j];
+                    if (hasPhi[d] == v) continue;
+                    hasPhi[d] = v;
+                    int phi = newValue(v, -1, d);
+                    values[phi].phiArgs.assign(preds[d].size(), -1);
+                    phis[d].push_back(phi);
+                    if (queued[d] != v) {
+                        queued[d] = v;
+                        work.push_back(d);
+                    }
+                }
+            }
+        }
+
+        useValue.assign(quad.size() * 3, -1);
+        defValue.assign(quad.size(), -1);
+        walkDominatorTree(false);
+    }
+
+    // rename the variables in dominator tree order; with rewrite set, replace
+    // constant and copied uses using the versions built by the first walk
+    void walkDominatorTree(bool rewrite) {
+        versions.assign(varSym.size(), std::vector<int>());
+        pushedVars.clear();
+        std::vector<std::pair<int, int>> stack;  // block, next child
+        std::vector<int> pushedMark;
+        stack.push_back({ blockCount, 0 });
+        pushedMark.push_back(0);
+        visitBlock(blockCount, rewrite);
+        while (!stack.empty()) {
+            int b = stack.back().first;
+            if (stack.back().second < static_cast<int>(domChildren[b].size())) {
+                int child = domChildren[b][stack.back().second++];
+                stack.push_back({ child, 0 });
+                pushedMark.push_back(static_cast<int>(pushedVars.size()));
+                visitBlock(child, rewrite);
+            }
+            else {
+                while (static_cast<int>(pushedVars.size()) > pushedMark.back()) {
+                    versions[pushedVars.back()].pop_back();
+                    pushedVars.pop_back();
+                }
+                pushedMark.pop_back();
+                stack.pop_back();
+            }
+        }
+    }
+
+    void visitBlock(int b, bool rewrite) {
+        for (int j = 0; j < static_cast<int>(phis[b].size()); j++) pushVersion(values[phis[b][j]].var, phis[b][j]);
+        if (b < blockCount) {
+            BasicBlock & block = symbolTable.getCFG().getBlock(b);
+            for (int i = block.first; i < block.last; i++) {
+                for (int k = 0; k < 3; k++) {
+                    if (!iCodeReads(quad[i].opcode, k)) continue;
+                    if (rewrite) {
+                        if (useValue[i * 3 + k] >= 0) rewriteUse(i, k);
+                    }
+                    else if (isVariable(operandAt(quad[i], k))) {
+                        int value = currentVersion(varIndex(operandAt(quad[i], k)));
+                        useValue[i * 3 + k] = value;
+                        values[value].quadUsers.push_back(i);
+                    }
+                }
+                int w = iCodeWrites(quad[i].opcode);
+                if (w < 0 || !isVariable(operandAt(quad[i], w))) continue;
+                if (!rewrite) {
+                    int var = varIndex(operandAt(quad[i], w));
+                    defValue[i] = newValue(var, i, -1);
+                    if (quad[i].opcode == MOV && useValue[i * 3] >= 0 &&
+                        (symbolTable.getTypeCode(quad[i].operand1.value) == Y_Char) == (symbolTable.getTypeCode(varSym[var]) == Y_Char))
+                        values[defValue[i]].copyOf = useValue[i * 3];
+                }
+                pushVersion(values[defValue[i]].var, defValue[i]);
+            }
+        }
+        if (rewrite) return;
+        for (int j = 0; j < static_cast<int>(succs[b].size()); j++) {
+            int s = succs[b][j];
+            int index = static_cast<int>(std::find(preds[s].begin(), preds[s].end(), b) - preds[s].begin());
+            for (int p = 0; p < static_cast<int>(phis[s].size()); p++) {
+                SSAValue & phi = values[phis[s][p]];
+                int arg = currentVersion(phi.var);
+                phi.phiArgs[index] = arg;
+                values[arg].phiUsers.push_back(phis[s][p]);
+            }
+        }
+    }
+
+    void rewriteUse(int i, int k) {
+        SSAValue & value = values[useValue[i * 3 + k]];
+        OPERAND & opr = operandAt(quad[i], k);
+        if (value.state == L_Const) {
+            int literal = literalFor(value.constant, opr.value);
+            if (literal != 0) {
+                opr = opSym(literal);
+                return;
+            }
+        }
+        // the furthest copy source that still holds the same value here
+        int source = -1;
+        for (int w = value.copyOf; w >= 0; w = values[w].copyOf) {
+            if (currentVersion(values[w].var) == w) source = w;
+        }
+        if (source >= 0) opr = opSym(varSym[values[source].var]);
+    }
+
+    // ---- sparse conditional constant propagation ----
+
+    void operandLattice(int i, int k, LatticeState & state, int & constant) {
+        if (useValue[i * 3 + k] >= 0) {
+            state = values[useValue[i * 3 + k]].state;
+            constant = values[useValue[i * 3 + k]].constant;
+        }
+        else {
+            state = literalValue(operandAt(quad[i], k), constant) ? L_Const : L_Bottom;
+        }
+    }
+
+    void setLattice(int value, LatticeState state, int constant) {
+        SSAValue & v = values[value];
+        if (v.state == state && (state != L_Const || v.constant == constant)) return;
+        if (v.state == L_Bottom) return;
+        if (v.state == L_Const && state == L_Const) state = L_Bottom;  // lattice only goes down
+        v.state = state;
+        v.constant = constant;
+        ssaWork.push_back(value);
+    }
+
+    void addFlowEdge(int from, int to) {
+        if (to >= 0) flowWork.push_back({ from, to });
+    }
+
+    int branchTarget(int i) {
+        return symbolTable.getCFG().getLabelBlock(quad[i].opcode == JMP ? quad[i].operand1.value : quad[i].operand2.value);
+    }
+
+    int fallThrough(int b) {
+        if (b + 1 >= blockCount || quad[symbolTable.getCFG().getBlock(b + 1).first].opcode == FUNC) return -1;
+        return b + 1;
+    }
+
+    void visitQuad(int i) {
+        if (defValue[i] >= 0) {
+            LatticeState state = L_Bottom;
+            int constant = 0;
+            if (quad[i].opcode == MOV) {
+                operandLattice(i, 0, state, constant);
+            }
+            else if (isBinaryICode(quad[i].opcode)) {
+                LatticeState stateA, stateB;
+                int a = 0, b = 0;
+                operandLattice(i, 0, stateA, a);
+                operandLattice(i, 1, stateB, b);
+                if (stateA == L_Bottom || stateB == L_Bottom) state = L_Bottom;
+                else if (stateA == L_Top || stateB == L_Top) state = L_Top;
+                else state = fold(quad[i].opcode, a, b, constant) ? L_Const : L_Bottom;
+            }
+            setLattice(defValue[i], state, constant);
+        }
+        int b = blockOf[i];
+        if (i != symbolTable.getCFG().getBlock(b).last - 1) return;
+        switch (quad[i].opcode) {
+            case JMP:
+                addFlowEdge(b, branchTarget(i));
+                break;
+            case BF:
+            {
+                LatticeState state;
+                int constant = 0;
+                operandLattice(i, 0, state, constant);
+                if (state == L_Bottom || (state == L_Const && constant == 0)) addFlowEdge(b, branchTarget(i));
+                if (state == L_Bottom || (state == L_Const && constant != 0)) addFlowEdge(b, fallThrough(b));
+            }
+                break;
+            default:
+                for (int j = 0; j < static_cast<int>(succs[b].size()); j++) addFlowEdge(b, succs[b][j]);
+                break;
+        }
+    }
+
+    void visitPhi(int phi) {
+        SSAValue & value = values[phi];
+        LatticeState state = L_Top;
+        int constant = 0;
+        for (int j = 0; j < static_cast<int>(value.phiArgs.size()) && state != L_Bottom; j++) {
+            if (!edgeExecutable.count(edgeKey(preds[value.phiBlock][j], value.phiBlock))) continue;
+            SSAValue & arg = values[value.phiArgs[j]];
+            if (arg.state == L_Top) continue;
+            if (arg.state == L_Bottom || (state == L_Const && arg.constant != constant)) state = L_Bottom;
+            else {
+                state = L_Const;
+                constant = arg.constant;
+            }
+        }
+        setLattice(phi, state, constant);
+    }
+
+    long long edgeKey(int from, int to) {
+        return (static_cast<long long>(from) << 32) | static_cast<unsigned int>(to);
+    }
+
+    void propagateConstants() {
+        blockExecutable.assign(blockCount + 1, false);
+        edgeExecutable.clear();
+        flowWork.clear();
+        ssaWork.clear();
+        blockExecutable[blockCount] = true;
+        for (int j = 0; j < static_cast<int>(succs[blockCount].size()); j++) addFlowEdge(blockCount, succs[blockCount][j]);
+        while (!flowWork.empty() || !ssaWork.empty()) {
+            if (!flowWork.empty()) {
+                std::pair<int, int> edge = flowWork.back();
+                flowWork.pop_back();
+                if (!edgeExecutable.insert(edgeKey(edge.first, edge.second)).second) continue;
+                int b = edge.second;
+                for (int j = 0; j < static_cast<int>(phis[b].size()); j++) visitPhi(phis[b][j]);
+                if (blockExecutable[b]) continue;
+                blockExecutable[b] = true;
+                BasicBlock & block = symbolTable.getCFG().getBlock(b);
+                for (int i = block.first; i < block.last; i++) visitQuad(i);
+            }
+            else {
+                int value = ssaWork.back();
+                ssaWork.pop_back();
+                for (int j = 0; j < static_cast<int>(values[value].phiUsers.size()); j++) {
+                    int phi = values[value].phiUsers[j];
+                    if (blockExecutable[values[phi].phiBlock]) visitPhi(phi);
+                }
+                for (int j = 0; j < static_cast<int>(values[value].quadUsers.size()); j++) {
+                    int i = values[value].quadUsers[j];
+                    if (blockExecutable[blockOf[i]]) visitQuad(i);
+                }
+            }
+        }
+    }
+
+    // ---- rewriting ----
+
+    // drop the removed quads, moving any label still jumped to onto the next quad kept
+    void compact(const std::vector<bool> & removed) {
+        std::vector<bool> referenced(symbolTable.getLabelCount(), false);
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (removed[i]) continue;
+            if (quad[i].operand1.kind == O_Label) referenced[quad[i].operand1.value] = true;
+            if (quad[i].operand2.kind == O_Label) referenced[quad[i].operand2.value] = true;
+        }
+        std::vector<QUAD> kept;
+        int pendingLabel = 0;
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (removed[i]) {
+                if (quad[i].label == 0 || !referenced[quad[i].label]) continue;
+                if (pendingLabel == 0) pendingLabel = quad[i].label;
+                else symbolTable.backPatching(quad[i].label, pendingLabel);
+                continue;
+            }
+            kept.push_back(quad[i]);
+            if (pendingLabel != 0) {
+                if (kept.back().label == 0) kept.back().label = pendingLabel;
+                else symbolTable.backPatching(pendingLabel, kept.back().label);
+                pendingLabel = 0;
+            }
+        }
+        if (pendingLabel != 0) kept.push_back({ 0, NOP, opNone(), opNone(), opNone(), pendingLabel });
+        quad.swap(kept);
+    }
+
+    // SCCP and copy propagation, then fold the branches and drop unreachable code
+    bool propagate() {
+        buildGraph();
+        buildSSA();
+        propagateConstants();
+        walkDominatorTree(true);
+
+        bool changed = false;
+        std::vector<bool> removed(quad.size(), false);
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (!blockExecutable[blockOf[i]]) {
+                removed[i] = true;
+                changed = true;
+                continue;
+            }
+            int constant = 0;
+            if (defValue[i] >= 0 && values[defValue[i]].state == L_Const && isBinaryICode(quad[i].opcode)) {
+                OPERAND target = quad[i].operand3;
+                int literal = literalFor(values[defValue[i]].constant, target.value);
+                if (literal != 0) {
+                    quad[i].opcode = MOV;
+                    quad[i].operand1 = opSym(literal);
+                    quad[i].operand2 = target;
+                    quad[i].operand3 = opNone();
+                    changed = true;
+                }
+            }
+            else if (quad[i].opcode == MOV && quad[i].operand1.kind == O_Sym && quad[i].operand1.value == quad[i].operand2.value) {
+                removed[i] = true;
+                changed = true;
+            }
+            else if (quad[i].opcode == JMP && i + 1 < static_cast<int>(quad.size()) && quad[i + 1].label != 0 &&
+                     symbolTable.resolveLabel(quad[i + 1].label) == quad[i].operand1.value) {
+                removed[i] = true;
+                changed = true;
+            }
+            else if (quad[i].opcode == BF && literalValue(quad[i].operand1, constant)) {
+                if (constant != 0) {
+                    removed[i] = true;
+                }
+                else {
+                    quad[i].opcode = JMP;
+                    quad[i].operand1 = quad[i].operand2;
+                    quad[i].operand2 = opNone();
+                }
+                changed = true;
+            }
+        }
+        compact(removed);
+        return changed;
+    }
+
+    bool isValueOperand(OPERAND opr) {
+        int constant = 0;
+        return isVariable(opr) || literalValue(opr, constant) || (opr.kind == O_Sym && opr.value == symbolTable.getNullID());
+    }
+
+    // quads that only compute a variable, safe to drop when nothing reads it
+    bool isPure(int i) {
+        if (defValue[i] < 0) return false;
+        if (quad[i].opcode == MOV) return isValueOperand(quad[i].operand1);
+        if (!isBinaryICode(quad[i].opcode)) return false;
+        int divisor = 0;
+        if (quad[i].opcode == DIV && (!literalValue(quad[i].operand2, divisor) || divisor == 0 || divisor == -1)) return false;
+        return isValueOperand(quad[i].operand1) && isValueOperand(quad[i].operand2);
+    }
+
+    bool eliminateDeadCode() {
+        buildGraph();
+        buildSSA();
+        std::vector<bool> live(quad.size(), false);
+        std::vector<bool> valueLive(values.size(), false);
+        std::vector<int> work;
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (rpoIndex[blockOf[i]] >= 0 && isPure(i)) continue;
+            live[i] = true;
+            for (int k = 0; k < 3; k++) {
+                if (useValue[i * 3 + k] >= 0) work.push_back(useValue[i * 3 + k]);
+            }
+        }
+        while (!work.empty()) {
+            int value = work.back();
+            work.pop_back();
+            if (valueLive[value]) continue;
+            valueLive[value] = true;
+            SSAValue & v = values[value];
+            if (v.phiBlock >= 0) {
+                for (int j = 0; j < static_cast<int>(v.phiArgs.size()); j++) {
+                    if (v.phiArgs[j] >= 0) work.push_back(v.phiArgs[j]);
+                }
+            }
+            else if (v.defQuad >= 0 && !live[v.defQuad]) {
+                live[v.defQuad] = true;
+                for (int k = 0; k < 3; k++) {
+                    if (useValue[v.defQuad * 3 + k] >= 0) work.push_back(useValue[v.defQuad * 3 + k]);
+                }
+            }
+        }
+        std::vector<bool> removed(quad.size(), false);
+        bool changed = false;
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            if (!live[i]) {
+                removed[i] = true;
+                changed = true;
+            }
+        }
+        compact(removed);
+        return changed;
+    }
+
+    // "OP a, b, T; MOV T, x" where T is read nowhere else becomes "OP a, b, x"
+    bool coalesceTemporaries() {
+        buildGraph();
+        buildSSA();
+        std::vector<bool> removed(quad.size(), false);
+        bool changed = false;
+        for (int i = 0; i + 1 < static_cast<int>(quad.size()); i++) {
+            if (defValue[i] < 0) continue;
+            SSAValue & value = values[defValue[i]];
+            int temp = varSym[value.var];
+            QUAD & next = quad[i + 1];
+            if (symbolTable.getKindCode(temp) != K_Tvar || !value.phiUsers.empty() ||
+                value.quadUsers.size() != 1 || value.quadUsers[0] != i + 1) continue;
+            if (next.opcode != MOV || next.label != 0 || next.operand1.kind != O_Sym || next.operand1.value != temp ||
+                next.operand2.kind != O_Sym || (symbolTable.getTypeCode(temp) == Y_Char) != (symbolTable.getTypeCode(next.operand2.value) == Y_Char)) continue;
+            operandAt(quad[i], iCodeWrites(quad[i].opcode)) = next.operand2;
+            removed[i + 1] = true;
+            changed = true;
+            i++;
+        }
+        compact(removed);
+        return changed;
+    }
+
+public:
+    Optimizer(SymTable & table) : symbolTable(table), quad(table.getICode()) {}
+
+    void run(int level) {
+        if (level <= 0) return;
+        for (int round = 0; round < OPT_MAX_ROUNDS; round++) {
+            bool changed = propagate();
+            changed = eliminateDeadCode() || changed;
+            changed = coalesceTemporaries() || changed;
+            if (!changed) break;
+        }
+    }
+};
+
+#endif /* Optimizer_hpp */
@@ -0,0 +1,237 @@
+//
+//  Peephole.hpp
+//  compiler
+//
+
+#ifndef Peephole_hpp
+#define Peephole_hpp
+
+#include <vector>
+#include <string>
+#include <map>
+#include "SymTable.hpp"
+
+#define PEEPHOLE_WINDOW 8  // instructions a rule may look ahead
+
+// windowed peephole optimizer over the target code, independent of the quads,
+// so it works on the output of any -O level. Comment lines are skipped, a
+// labelled instruction may only start a window since control can enter there.
+// Rules are tried at every instruction until none of them applies anymore.
+class PeepholeOptimizer {
+private:
+    typedef bool (PeepholeOptimizer::*RuleFunction)(int at);
+    struct PeepholeRule {
+        const char * name;
+        RuleFunction apply;  // tries the rule at instruction at, true if it changed the code
+    };
+
+    std::vector<TCODE> & tCode;
+    std::vector<bool> removed;
+    std::map<std::string, std::string> constants;  // .INT value -> label of the directive
+    int removedCount = 0;
+    std::vector<int> ruleHits;  // rule -> times it changed the code
+
+    bool isInstruction(int i) {
+        return !removed[i] && tCode[i].opcode != "" && tCode[i].opcode[0] != '.';
+    }
+
+    // the next count instructions from at, fewer if a label, a jump or a trap
+    // cuts the window short (the labelled or control instruction is included)
+    std::vector<int> window(int at, int count) {
+        std::vector<int> result;
+        for (int i = at; i < static_cast<int>(tCode.size()) && static_cast<int>(result.size()) < count; i++) {
+            if (!isInstruction(i)) {
+                if (!removed[i] && tCode[i].opcode != "") break;  // data directive
+                continue;
+            }
+            if (!result.empty() && tCode[i].label != "") break;
+            result.push_back(i);
+            if (isControl(tCode[i])) break;
+        }
+        return result;
+    }
+
+    static bool isBranch(const std::string & op) {
+        return op == "JMP" || op == "JMR" || op == "BNZ" || op == "BGT" || op == "BLT" || op == "BRZ"
+            || op == "BEQ" || op == "BNE" || op == "BLE" || op == "BGE" || op == "CALL" || op == "RET" || op == "FRAME";
+    }
+
+    static bool isControl(const TCODE & code) {
+        return isBranch(code.opcode) || code.opcode == "TRP" || code.operand1 == "PC" || code.operand2 == "PC";
+    }
+
+    // register the instruction writes, "" if none
+    static std::string writtenRegister(const TCODE & code) {
+        const std::string & op = code.opcode;
+        if (op == "STR" || op == "STB" || op == "STRO" || op == "STBO" || op == "PUSH" || op == "TRP" || isBranch(op)) return "";
+        return code.operand1;
+    }
+
+    bool is(int i, const char * opcode, const std::string & operand1, const std::string & operand2) {
+        return tCode[i].opcode == opcode && tCode[i].operand1 == operand1 && tCode[i].operand2 == operand2;
+    }
+
+    void remove(int i) {
+        removed[i] = true;
+        removedCount++;
+    }
+
+    void replace(int i, std::string opcode, std::string operand1, std::string operand2) {
+        tCode[i].opcode = opcode;
+        tCode[i].operand1 = operand1;
+        tCode[i].operand2 = operand2;
+        tCode[i].operand3 = "";
+    }
+
+    // MOV Rx, Rx
+    bool selfMove(int at) {
+        if (tCode[at].opcode != "MOV" || tCode[at].operand1 != tCode[at].operand2 || tCode[at].label != "") return false;
+        remove(at);
+        return true;
+    }
+
+    // ADI Rx, 0
+    bool addZero(int at) {
+        if (tCode[at].opcode != "ADI" || tCode[at].operand2 != "0" || tCode[at].label != "") return false;
+        remove(at);
+        return true;
+    }
+
+    // MOV Ra, Rb; MOV Rb, Ra  ->  MOV Ra, Rb
+    bool moveBack(int at) {
+        std::vector<int> w = window(at, 2);
+        if (w.size() < 2 || tCode[at].opcode != "MOV") return false;
+        if (!is(w[1], "MOV", tCode[at].operand2, tCode[at].operand1)) return false;
+        remove(w[1]);
+        return true;
+    }
+
+    // JMP L; L: ...  ->  L: ...
+    bool jumpToNext(int at) {
+        if (tCode[at].opcode != "JMP" || tCode[at].label != "") return false;
+        for (int i = at + 1; i < static_cast<int>(tCode.size()); i++) {
+            if (!isInstruction(i)) continue;
+            if (tCode[i].label != tCode[at].operand1) return false;
+            remove(at);
+            return true;
+        }
+        return false;
+    }
+
+    // LDRO Ra, FP, -8; ... LDRO Rb, FP, -8  ->  LDRO Ra, FP, -8; ... MOV Rb, Ra, the this
+    // pointer is read again for every field access, drop the reload when nothing in
+    // between writes Ra or FP or stores to the this slot
+    bool thisReload(int at) {
+        std::vector<int> w = window(at, PEEPHOLE_WINDOW);
+        if (w.size() < 2 || !isThisLoad(tCode[at])) return false;
+        const std::string & thisReg = tCode[at].operand1;
+        if (thisReg == "FP") return false;
+        for (int n = 1; n < static_cast<int>(w.size()); n++) {
+            TCODE & code = tCode[w[n]];
+            if (isThisLoad(code)) {
+                if (code.operand1 == thisReg)
+                    remove(w[n]);
+                else
+                    replace(w[n], "MOV", code.operand1, thisReg);
+                return true;
+            }
+            std::string reg = writtenRegister(code);
+            if (reg == thisReg || reg == "FP") return false;
+            if ((code.opcode == "STRO" || code.opcode == "STBO") && code.operand2 == "FP" && code.operand3 == "-8") return false;
+        }
+        return false;
+    }
+
+    static bool isThisLoad(const TCODE & code) {
+        return code.opcode == "LDRO" && code.operand2 == "FP" && code.operand3 == "-8";
+    }
+
+    // STR Ra, X; LDR Rb, X  ->  STR Ra, X; MOV Rb, Ra, also for STRO/LDRO with the same base and displacement
+    bool storeLoad(int at) {
+        std::vector<int> w = window(at, 2);
+        if (w.size() < 2 || !((tCode[at].opcode == "STR" && tCode[w[1]].opcode == "LDR")
+                              || (tCode[at].opcode == "STRO" && tCode[w[1]].opcode == "LDRO"))) return false;
+        if (tCode[w[1]].operand2 != tCode[at].operand2 || tCode[w[1]].operand3 != tCode[at].operand3) return false;
+        if (tCode[at].operand1 == tCode[at].operand2) return false;
+        if (tCode[w[1]].operand1 == tCode[at].operand1)
+            remove(w[1]);
+        else
+            replace(w[1], "MOV", tCode[w[1]].operand1, tCode[at].operand1);
+        return true;
+    }
+
+    // SUB Rx, Rx; ADI Rx, k  ->  LDR Rx, <.INT k>
+    bool loadConstant(int at) {
+        std::vector<int> w = window(at, 2);
+        if (w.size() < 2 || tCode[at].opcode != "SUB" || tCode[at].operand1 != tCode[at].operand2) return false;
+        if (!is(w[1], "ADI", tCode[at].operand1, tCode[w[1]].operand2)) return false;
+        std::map<std::string, std::string>::iterator constant = constants.find(tCode[w[1]].operand2);
+        if (constant == constants.end()) return false;
+        replace(at, "LDR", tCode[at].operand1, constant->second);
+        remove(w[1]);
+        return true;
+    }
+
+    // tried in this order at every instruction, ends with a null entry
+    static const PeepholeRule * ruleTable() {
+        static const PeepholeRule rules[] = {
+            { "self move", &PeepholeOptimizer::selfMove },
+            { "add zero", &PeepholeOptimizer::addZero },
+            { "move back", &PeepholeOptimizer::moveBack },
+            { "jump to next", &PeepholeOptimizer::jumpToNext },
+            { "this reload", &PeepholeOptimizer::thisReload },
+            { "store load", &PeepholeOptimizer::storeLoad },
+            { "load constant", &PeepholeOptimizer::loadConstant },
+            { nullptr, nullptr }
+        };
+        return rules;
+    }
+
+public:
+    PeepholeOptimizer(std::vector<TCODE> & tCode) : tCode(tCode) {
+        for (int i = 0; i < static_cast<int>(tCode.size()); i++) {
+            if (tCode[i].opcode == ".INT" && tCode[i].label != "" && constants.find(tCode[i].operand1) == constants.end())
+                constants[tCode[i].operand1] = tCode[i].label;
+        }
+    }
+
+    // number of instructions removed
+    int run() {
+        removed.assign(tCode.size(), false);
+        ruleHits.clear();
+        for (const PeepholeRule * rule = ruleTable(); rule->name != nullptr; rule++) ruleHits.push_back(0);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int i = 0; i < static_cast<int>(tCode.size()); i++) {
+                if (!isInstruction(i)) continue;
+                const PeepholeRule * rules = ruleTable();
+                for (int r = 0; rules[r].name != nullptr && !removed[i]; r++) {
+                    if (!(this->*rules[r].apply)(i)) continue;
+                    ruleHits[r]++;
+                    changed = true;
+                }
+            }
+        }
+        int next = 0;
+        for (int i = 0; i < static_cast<int>(tCode.size()); i++) {
+            if (!removed[i]) tCode[next++] = tCode[i];
+        }
+        tCode.resize(next);
+        return removedCount;
+    }
+
+    // "N instructions removed, rule hits: ..." for the last run
+    std::string report() {
+        std::string result = std::to_string(removedCount) + " instructions removed";
+        std::string hits = "";
+        const PeepholeRule * rules = ruleTable();
+        for (int r = 0; r < static_cast<int>(ruleHits.size()); r++) {
+            if (ruleHits[r] == 0) continue;
+            hits += (hits == "" ? "" : ", ") + std::string(rules[r].name) + " " + std::to_string(ruleHits[r]);
+        }
+        return hits == "" ? result : result + ", rule hits: " + hits;
+    }
+};
+
+#endif /* Peephole_hpp */
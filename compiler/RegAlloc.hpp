@@ -0,0 +1,259 @@
+//
+//  RegAlloc.hpp
+//  compiler
+//
+
+#ifndef RegAlloc_hpp
+#define RegAlloc_hpp
+
+#include <vector>
+#include <algorithm>
+#include "SymTable.hpp"
+
+#define REGALLOC_FIRST 0      // R0..R7 may hold variables
+#define REGALLOC_LAST 7
+#define REGALLOC_MAX_DEPTH 4  // loop nesting counted in the spill weight
+
+// points [start, end] in which a variable may be live, quad i reads its
+// operands at point 2 * i and stores its result at point 2 * i + 1
+struct LiveInterval {
+    int var;        // index into RegisterAllocator::varSym
+    int start;
+    int end;
+    int forbidden;  // bit n set if the code of some quad in the interval writes Rn
+    long long weight;
+    int reg;        // -1 if it stays in memory
+};
+
+// linear scan register allocation over the quads, run after the Optimizer at -O2.
+// Each function is allocated on its own. Locals and temporaries that are not
+// char (those are bytes in memory) and are never read before they are written
+// get a live interval over the quad order; an interval gets a register from
+// R0-R7 that no quad inside it uses as scratch (SymTable::tCodeScratch), so anything live across a CALL
+// stays in memory. When the registers run out the interval with the lowest
+// weight (uses, times 10 per loop it is in) is spilled. Spilled variables keep
+// their frame slot for their whole life, so no spill code is needed and the
+// allocation is only visible to loadDataCode/storeDataCode.
+class RegisterAllocator {
+private:
+    SymTable & symbolTable;
+    std::vector<QUAD> & quad;
+    CFG & cfg;
+
+    // candidates of the function being allocated
+    std::vector<int> varSym;  // var index -> symbol id
+    std::vector<int> varOf;   // symbol id - SYMID_START -> var index, -1 if not a candidate
+    std::vector<LiveInterval> intervals;  // var -> interval, start -1 if never seen
+
+    static OPERAND & operandAt(QUAD & code, int k) {
+        return k == 0 ? code.operand1 : (k == 1 ? code.operand2 : code.operand3);
+    }
+
+    bool isCandidate(int id) {
+        SymKind kind = symbolTable.getKindCode(id);
+        return (kind == K_Lvar || kind == K_Tvar || kind == K_Lval)
+            && symbolTable.getIDType(id) != 'R' && symbolTable.getTypeCode(id) != Y_Char;
+    }
+
+    // candidate read as operand k (0-2) of quad i, -1 if none
+    int readVar(int i, int k) {
+        if (!iCodeReads(quad[i].opcode, k)) return -1;
+        OPERAND opr = operandAt(quad[i], k);
+        return opr.kind == O_Sym && symbolTable.isValidID(opr.value) ? varOf[opr.value - SYMID_START] : -1;
+    }
+
+    // candidate stored by quad i, -1 if none
+    int writtenVar(int i) {
+        int w = iCodeWrites(quad[i].opcode);
+        if (w < 0) return -1;
+        OPERAND opr = operandAt(quad[i], w);
+        return opr.kind == O_Sym && symbolTable.isValidID(opr.value) ? varOf[opr.value - SYMID_START] : -1;
+    }
+
+    void collectCandidates(int firstQuad, int lastQuad) {
+        varSym.clear();
+        for (int i = firstQuad; i < lastQuad; i++) {
+            for (int k = 0; k < 3; k++) {
+                OPERAND opr = operandAt(quad[i], k);
+                if (opr.kind != O_Sym || !symbolTable.isValidID(opr.value)) continue;
+                if (varOf[opr.value - SYMID_START] != -1 || !isCandidate(opr.value)) continue;
+                varOf[opr.value - SYMID_START] = static_cast<int>(varSym.size());
+                varSym.push_back(opr.value);
+            }
+        }
+    }
+
+    // blocks [firstBlock, lastBlock) form one function
+    void allocateFunction(int firstBlock, int lastBlock) {
+        int firstQuad = cfg.getBlock(firstBlock).first;
+        int lastQuad = cfg.getBlock(lastBlock - 1).last;
+        collectCandidates(firstQuad, lastQuad);
+        int varCount = static_cast<int>(varSym.size());
+        if (varCount == 0) return;
+        int blockCount = lastBlock - firstBlock;
+
+        // liveness per block
+        std::vector<std::vector<bool>> gen(blockCount, std::vector<bool>(varCount, false));
+        std::vector<std::vector<bool>> kill(blockCount, std::vector<bool>(varCount, false));
+        std::vector<std::vector<bool>> liveIn(blockCount, std::vector<bool>(varCount, false));
+        std::vector<std::vector<bool>> liveOut(blockCount, std::vector<bool>(varCount, false));
+        for (int b = 0; b < blockCount; b++) {
+            BasicBlock & block = cfg.getBlock(firstBlock + b);
+            for (int i = block.first; i < block.last; i++) {
+                for (int k = 0; k < 3; k++) {
+                    int v = readVar(i, k);
+                    if (v >= 0 && !kill[b][v]) gen[b][v] = true;
+                }
+                int w = writtenVar(i);
+                if (w >= 0) kill[b][w] = true;
+            }
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int b = blockCount - 1; b >= 0; b--) {
+                BasicBlock & block = cfg.getBlock(firstBlock + b);
+                for (int s = 0; s < static_cast<int>(block.successors.size()); s++) {
+                    int succ = block.successors[s] - firstBlock;
+                    for (int v = 0; v < varCount; v++) {
+                        if (liveIn[succ][v]) liveOut[b][v] = true;
+                    }
+                }
+                for (int v = 0; v < varCount; v++) {
+                    bool in = gen[b][v] || (liveOut[b][v] && !kill[b][v]);
+                    if (in && !liveIn[b][v]) {
+                        liveIn[b][v] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        // loop depth of every quad from the backward edges
+        std::vector<int> depth(lastQuad - firstQuad + 1, 0);
+        for (int b = firstBlock; b < lastBlock; b++) {
+            BasicBlock & block = cfg.getBlock(b);
+            for (int s = 0; s < static_cast<int>(block.successors.size()); s++) {
+                BasicBlock & head = cfg.getBlock(block.successors[s]);
+                if (head.first > block.first) continue;
+                depth[head.first - firstQuad]++;
+                depth[block.last - firstQuad]--;
+            }
+        }
+        for (int i = 1; i < static_cast<int>(depth.size()); i++) depth[i] += depth[i - 1];
+
+        // intervals, walking each block backwards from its live out set
+        intervals.assign(varCount, { 0, -1, -1, 0, 0, -1 });
+        for (int v = 0; v < varCount; v++) intervals[v].var = v;
+        std::vector<int> live;
+        std::vector<bool> isLive(varCount, false);
+        for (int b = 0; b < blockCount; b++) {
+            BasicBlock & block = cfg.getBlock(firstBlock + b);
+            live.clear();
+            for (int v = 0; v < varCount; v++) {
+                isLive[v] = liveOut[b][v];
+                if (isLive[v]) {
+                    live.push_back(v);
+                    extend(v, 2 * block.last - 1);
+                }
+            }
+            for (int i = block.last - 1; i >= block.first; i--) {
+                long long weight = 1;
+                for (int d = 0; d < std::min(depth[i - firstQuad], REGALLOC_MAX_DEPTH); d++) weight *= 10;
+                int mask = SymTable::tCodeScratch(quad[i].opcode);
+                int w = writtenVar(i);
+                bool wRead = false;
+                for (int k = 0; k < 3; k++) {
+                    if (readVar(i, k) == w) wRead = true;
+                }
+                if (w >= 0) {
+                    extend(w, 2 * i + 1);
+                    intervals[w].weight += weight;
+                    // the variable is stored after the quad's scratch registers are used
+                    if (isLive[w] && !wRead) isLive[w] = false;
+                }
+                for (int n = 0; n < static_cast<int>(live.size()); n++) {
+                    if (isLive[live[n]]) {
+                        extend(live[n], 2 * i);
+                        intervals[live[n]].forbidden |= mask;
+                    }
+                }
+                for (int k = 0; k < 3; k++) {
+                    int v = readVar(i, k);
+                    if (v < 0) continue;
+                    extend(v, 2 * i);
+                    intervals[v].forbidden |= mask;
+                    intervals[v].weight += weight;
+                    if (!isLive[v]) {
+                        isLive[v] = true;
+                        live.push_back(v);
+                    }
+                }
+            }
+        }
+
+        // anything live on entry is read before it is written on some path
+        std::vector<LiveInterval *> order;
+        for (int v = 0; v < varCount; v++) {
+            if (intervals[v].start >= 0 && !liveIn[0][v]) order.push_back(&intervals[v]);
+        }
+        std::sort(order.begin(), order.end(), [](const LiveInterval * a, const LiveInterval * b) {
+            return a->start != b->start ? a->start < b->start : a->var < b->var;
+        });
+        linearScan(order);
+
+        for (int v = 0; v < varCount; v++) {
+            if (intervals[v].reg >= 0) symbolTable.setRegister(varSym[v], intervals[v].reg);
+            varOf[varSym[v] - SYMID_START] = -1;
+        }
+    }
+
+    void extend(int v, int point) {
+        if (intervals[v].start < 0 || point < intervals[v].start) intervals[v].start = point;
+        if (point > intervals[v].end) intervals[v].end = point;
+    }
+
+    void linearScan(std::vector<LiveInterval *> & order) {
+        std::vector<LiveInterval *> owner(REGALLOC_LAST + 1, nullptr);
+        for (int n = 0; n < static_cast<int>(order.size()); n++) {
+            LiveInterval * current = order[n];
+            for (int r = REGALLOC_FIRST; r <= REGALLOC_LAST; r++) {
+                if (owner[r] != nullptr && owner[r]->end < current->start) owner[r] = nullptr;
+            }
+            int chosen = -1;
+            for (int r = REGALLOC_FIRST; r <= REGALLOC_LAST && chosen < 0; r++) {
+                if (owner[r] == nullptr && !(current->forbidden & (1 << r))) chosen = r;
+            }
+            if (chosen < 0) {
+                // spill the cheapest interval holding a register this one could use
+                for (int r = REGALLOC_FIRST; r <= REGALLOC_LAST; r++) {
+                    if (current->forbidden & (1 << r)) continue;
+                    if (owner[r]->weight >= current->weight) continue;
+                    if (chosen < 0 || owner[r]->weight < owner[chosen]->weight) chosen = r;
+                }
+                if (chosen < 0) continue;
+                owner[chosen]->reg = -1;
+            }
+            current->reg = chosen;
+            owner[chosen] = current;
+        }
+    }
+
+public:
+    RegisterAllocator(SymTable & symbolTable) : symbolTable(symbolTable), quad(symbolTable.getICode()), cfg(symbolTable.getCFG()) {
+    }
+
+    void run(int level) {
+        if (level < 2) return;
+        symbolTable.buildCFG();
+        varOf.assign(symbolTable.getSymbolCount(), -1);
+        int firstBlock = 0;
+        for (int b = 1; b <= cfg.size(); b++) {
+            if (b < cfg.size() && quad[cfg.getBlock(b).first].opcode != FUNC) continue;
+            allocateFunction(firstBlock, b);
+            firstBlock = b;
+        }
+    }
+};
+
+#endif /* RegAlloc_hpp */
@@ -14,8 +14,23 @@
 #include <sstream>
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
+#include <cstring>
 #include <iterator>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define SCANNER_MMAP_SOURCE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define MIN_KEYWORD_LENGTH 2  // length of "if"
+#define MAX_KEYWORD_LENGTH 11  // length of "unprotected", longer identifiers skip the keyword lookup
+#define KEYWORD_HASH_SIZE 128  // power of 2
+
 enum TokenType {
     T_Number,
     T_Character,
@@ -46,86 +61,209 @@ struct Token {
     std::string lexeme;
 };
 
-class Scanner {
+// reserved words of KXI, recognized through KEYWORD_HASH_TABLE
+constexpr const char * KXI_KEYWORDS[] = {
+    "atoi", "and", "bool", "block", "break", "case", "class", "char", "cin", "cout", "default", "delete",
+    "else", "false", "if", "int", "itoa", "kxi2019", "lock", "main", "new", "null", "object", "or",
+    "public", "private", "protected", "return", "release", "string", "spawn", "sym", "set",
+    "switch", "this", "true", "thread", "unprotected", "unlock", "void", "while", "wait"
+};
+constexpr int KXI_KEYWORD_COUNT = sizeof(KXI_KEYWORDS) / sizeof(KXI_KEYWORDS[0]);
+
+constexpr int keywordLength(const char * str) {
+    int length = 0;
+    while (str[length] != '\0') length++;
+    return length;
+}
+
+// perfect hash of the keywords above, any string of at least MIN_KEYWORD_LENGTH chars can be hashed
+constexpr int keywordHash(const char * str, int length) {
+    return (length * 7 + str[1] * 5 + str[length - 1] * 25) & (KEYWORD_HASH_SIZE - 1);
+}
+
+// hash slot -> index in KXI_KEYWORDS, -1 for an empty slot
+struct KeywordHashTable {
+    int slots[KEYWORD_HASH_SIZE];
+};
+
+constexpr KeywordHashTable buildKeywordHashTable() {
+    KeywordHashTable table = {};
+    for (int i = 0; i < KEYWORD_HASH_SIZE; i++) {
+        table.slots[i] = -1;
+    }
+    for (int i = 0; i < KXI_KEYWORD_COUNT; i++) {
+        table.slots[keywordHash(KXI_KEYWORDS[i], keywordLength(KXI_KEYWORDS[i]))] = i;
+    }
+    return table;
+}
+
+constexpr KeywordHashTable KEYWORD_HASH_TABLE = buildKeywordHashTable();
+
+constexpr bool isPerfectKeywordHash() {
+    for (int i = 0; i < KXI_KEYWORD_COUNT; i++) {
+        int length = keywordLength(KXI_KEYWORDS[i]);
+        if (length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH
+            || KEYWORD_HASH_TABLE.slots[keywordHash(KXI_KEYWORDS[i], length)] != i) return false;
+    }
+    return true;
+}
+
+static_assert(isPerfectKeywordHash(), "keywordHash() has a collision, pick new multipliers");
+
+// a token as the scanner records it, a view of offset/length into the source
+struct TokenView {
+    TokenType type;
+    int offset;
+    int length;
+};
+
+// the whole source file, mapped read only when possible, line numbers are only
+// worked out when a token is turned into a Token
+class SourceFile {
 private:
-    std::ifstream inputFile;
-    Token currentToken, nextToken;
-    int lineIndex;
-    int charIndex;
-    std::string lineBuffer;
-    bool endLineFlag;
-    std::map<std::string, int> keywordTable;
-    std::map<std::string, int> twoCharSymbols;
-    
+    const char * data;
+    long size;
+    bool mapped;
+    std::string buffer;
+    int lineOffset;  // offset up to which lines have been counted
+    int lineCount;  // line of lineOffset, tokens are asked for in order so counting goes forward
+
 public:
-    Scanner(std::string filename) {
-        inputFile.open(filename);
+    SourceFile(std::string filename) {
+        data = "";
+        size = 0;
+        mapped = false;
+        lineOffset = 0;
+        lineCount = 1;
+#ifdef SCANNER_MMAP_SOURCE
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat fileStat;
+        if (fd < 0 || fstat(fd, & fileStat) != 0) {
+            std::cout << "Cannot open the file: " << filename << std::endl;
+            exit(1);
+        }
+        if (fileStat.st_size > 0) {
+            void * mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                data = static_cast<const char *>(mapping);
+                size = fileStat.st_size;
+                mapped = true;
+            }
+        }
+        close(fd);
+        if (mapped || fileStat.st_size == 0) return;
+#endif
+        std::ifstream inputFile(filename, std::ios::in | std::ios::binary);
         if (!inputFile.is_open()) {
             std::cout << "Cannot open the file: " << filename << std::endl;
             exit(1);
         }
+        buffer.assign(std::istreambuf_iterator<char>(inputFile), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = static_cast<long>(buffer.size());
+    }
+    
+    ~SourceFile() {
+#ifdef SCANNER_MMAP_SOURCE
+        if (mapped) munmap(const_cast<char *>(data), size);
+#endif
+    }
+    
+    SourceFile(const SourceFile &) = delete;
+    SourceFile & operator=(const SourceFile &) = delete;
+    
+    const char * getData() {
+        return data;
+    }
+    
+    int getSize() {
+        return static_cast<int>(size);
+    }
+    
+    // 1 based line of an offset, the end of the file is on the line after the last one
+    int lineOf(int offset) {
+        if (offset < lineOffset) {
+            lineOffset = 0;
+            lineCount = 1;
+        }
+        if (offset > size) offset = static_cast<int>(size);
+        while (lineOffset < offset) {
+            const void * newline = std::memchr(data + lineOffset, '\n', offset - lineOffset);
+            if (newline == nullptr) {
+                lineOffset = offset;
+            }
+            else {
+                lineOffset = static_cast<int>(static_cast<const char *>(newline) - data) + 1;
+                lineCount++;
+            }
+        }
+        if (offset == size && size > 0 && data[size - 1] != '\n') return lineCount + 1;
+        return lineCount;
+    }
+};
+
+class Scanner {
+private:
+    std::shared_ptr<SourceFile> source;
+    const char * sourceData;
+    int sourceSize;
+    int position;  // offset of the next character to lex
+    Token currentToken, nextToken;
+    std::vector<TokenView> tokens;  // every token lexed so far, or the tokens to replay
+    bool replayFlag;  // true when tokens come from a previous scan instead of the file
+    int replayIndex;
+    
+public:
+    Scanner(std::string filename) {
+        source = std::make_shared<SourceFile>(filename);
+        sourceData = source->getData();
+        sourceSize = source->getSize();
+        position = 0;
+        replayFlag = false;
+        replayIndex = 0;
 
         currentToken = { T_EOF, 0, "" };
         nextToken = { T_EOF, 0, "" };
-        lineIndex = 0;
-        charIndex = 0;
-        endLineFlag = true;
-        
-        keywordTable.insert(std::pair<std::string, int>("atoi",0));
-        keywordTable.insert(std::pair<std::string, int>("and",0));
-        keywordTable.insert(std::pair<std::string, int>("bool",0));
-        keywordTable.insert(std::pair<std::string, int>("block",0));
-        keywordTable.insert(std::pair<std::string, int>("break",0));
-        keywordTable.insert(std::pair<std::string, int>("case",0));
-        keywordTable.insert(std::pair<std::string, int>("class",0));
-        keywordTable.insert(std::pair<std::string, int>("char",0));
-        keywordTable.insert(std::pair<std::string, int>("cin",0));
-        keywordTable.insert(std::pair<std::string, int>("cout",0));
-        keywordTable.insert(std::pair<std::string, int>("default",0));
-        keywordTable.insert(std::pair<std::string, int>("else",0));
-        keywordTable.insert(std::pair<std::string, int>("false",0));
-        keywordTable.insert(std::pair<std::string, int>("if",0));
-        keywordTable.insert(std::pair<std::string, int>("int",0));
-        keywordTable.insert(std::pair<std::string, int>("itoa",0));
-        keywordTable.insert(std::pair<std::string, int>("kxi2019",0));
-        keywordTable.insert(std::pair<std::string, int>("lock",0));
-        keywordTable.insert(std::pair<std::string, int>("main",0));
-        keywordTable.insert(std::pair<std::string, int>("new",0));
-        keywordTable.insert(std::pair<std::string, int>("null",0));
-        keywordTable.insert(std::pair<std::string, int>("object",0));
-        keywordTable.insert(std::pair<std::string, int>("or",0));
-        keywordTable.insert(std::pair<std::string, int>("public",0));
-        keywordTable.insert(std::pair<std::string, int>("private",0));
-        keywordTable.insert(std::pair<std::string, int>("protected",0));
-        keywordTable.insert(std::pair<std::string, int>("return",0));
-        keywordTable.insert(std::pair<std::string, int>("release",0));
-        keywordTable.insert(std::pair<std::string, int>("string",0));
-        keywordTable.insert(std::pair<std::string, int>("spawn",0));
-        keywordTable.insert(std::pair<std::string, int>("sym",0));
-        keywordTable.insert(std::pair<std::string, int>("set",0));
-        keywordTable.insert(std::pair<std::string, int>("switch",0));
-        keywordTable.insert(std::pair<std::string, int>("this",0));
-        keywordTable.insert(std::pair<std::string, int>("true",0));
-        keywordTable.insert(std::pair<std::string, int>("thread",0));
-        keywordTable.insert(std::pair<std::string, int>("unprotected",0));
-        keywordTable.insert(std::pair<std::string, int>("unlock",0));
-        keywordTable.insert(std::pair<std::string, int>("void",0));
-        keywordTable.insert(std::pair<std::string, int>("while",0));
-        keywordTable.insert(std::pair<std::string, int>("wait",0));
-        
-        twoCharSymbols.insert(std::pair<std::string, int>("<<",1));
-        twoCharSymbols.insert(std::pair<std::string, int>(">>",1));
-        twoCharSymbols.insert(std::pair<std::string, int>("&&",0));
-        twoCharSymbols.insert(std::pair<std::string, int>("||",0));
-        twoCharSymbols.insert(std::pair<std::string, int>("==",0));
-        twoCharSymbols.insert(std::pair<std::string, int>("<=",0));
-        twoCharSymbols.insert(std::pair<std::string, int>(">=",0));
     }
     
-    ~Scanner() {
-        inputFile.close();
-    }
+    // replay the tokens recorded by an earlier Scanner of the same source instead of lexing it again
+    Scanner(std::shared_ptr<SourceFile> recordedSource, const std::vector<TokenView> & recordedTokens) {
+        source = recordedSource;
+        sourceData = source->getData();
+        sourceSize = source->getSize();
+        position = sourceSize;
+        tokens = recordedTokens;
+        replayFlag = true;
+        replayIndex = 0;
 
+        currentToken = { T_EOF, 0, "" };
+        nextToken = { T_EOF, 0, "" };
+    }
+    
+    static bool isKeyword(const char * str, int length) {
+        if (length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH) return false;
+        int index = KEYWORD_HASH_TABLE.slots[keywordHash(str, length)];
+        return index >= 0 && std::strncmp(KXI_KEYWORDS[index], str, length) == 0 && KXI_KEYWORDS[index][length] == '\0';
+    }
+    
+    // <<, >>, &&, ||, ==, <= and >=
+    static bool isTwoCharSymbol(char first, char second) {
+        switch (first) {
+            case '<':
+            return second == '<' || second == '=';
+            case '>':
+            return second == '>' || second == '=';
+            case '&':
+            return second == '&';
+            case '|':
+            return second == '|';
+            case '=':
+            return second == '=';
+            default:
+            return false;
+        }
+    }
+    
     CharGroup parseChar(char ch) {
         if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f') return C_Whitespace;
         if (ch >= '0' && ch <= '9') return C_Number;
@@ -156,121 +294,103 @@ public:
     // set new currentToken, and fecth a new token from the source file, if the file is end, set nextToken as a TOF
     void fetchTokens() {
         currentToken = nextToken;
-        
+        TokenView view;
+        if (replayFlag) {
+            if (replayIndex < static_cast<int>(tokens.size())) {
+                view = tokens[replayIndex];
+                replayIndex++;
+            }
+            else {
+                view = { T_EOF, sourceSize, 0 };
+            }
+        }
+        else {
+            view = lexToken();
+            tokens.push_back(view);
+        }
+        nextToken = makeToken(view);
+    }
+    
+    Token makeToken(TokenView view) {
+        if (view.type == T_EOF) return { T_EOF, source->lineOf(view.offset), "EOF" };
+        return { view.type, source->lineOf(view.offset), std::string(sourceData + view.offset, view.length) };
+    }
+    
+    // lex the next token straight from the source, tokens never span a line
+    TokenView lexToken() {
         while (true) {
-            if (endLineFlag || lineBuffer.empty() || charIndex >= lineBuffer.size()) {
-                lineIndex++;
-                if (std::getline(inputFile, lineBuffer)) {
-                    charIndex = 0;
-                    endLineFlag = false;
+            if (position >= sourceSize) {
+                return { T_EOF, sourceSize, 0 };
+            }
+            int start = position;
+            switch (parseChar(sourceData[position])) {
+                case C_Whitespace:
+                position++;
+                break;
+                case C_Number:
+                while (position < sourceSize && parseChar(sourceData[position]) == C_Number) {
+                    position++;
                 }
-                else {
-                    nextToken = { T_EOF, lineIndex, "EOF" };
-                    return;
+                return { T_Number, start, position - start };
+                case C_Letter:
+                while (position < sourceSize
+                       && (parseChar(sourceData[position]) == C_Number
+                           || parseChar(sourceData[position]) == C_Letter)) {
+                    position++;
                 }
-            }
-            else {
-                if (parseChar(lineBuffer[charIndex]) == C_Whitespace) {
-                    charIndex++;
+                if (isKeyword(sourceData + start, position - start)) {
+                    return { T_Keywords, start, position - start };
+                }
+                return { T_Identifier, start, position - start };
+                case C_Apostrophe:
+                position++;
+                if (position + 2 < sourceSize
+                    && parseChar(sourceData[position]) == C_Backslash
+                    && sourceData[position + 1] == 'n' // recognize '\n' only
+                    && parseChar(sourceData[position + 2]) == C_Apostrophe) {
+                    position += 3;
+                    return { T_Character, start, 4 };
+                }
+                else if (position + 1 < sourceSize
+                         && sourceData[position] != '\n'
+                         && parseChar(sourceData[position]) != C_Apostrophe // not accept '''
+                         && parseChar(sourceData[position]) != C_Backslash  // not accept '\'
+                         && parseChar(sourceData[position + 1]) == C_Apostrophe) {
+                    position += 2;
+                    return { T_Character, start, 3 };
+                }
+                return { T_Unknown, start, 1 };
+                case C_ExclamationMark:
+                position++;
+                if (position < sourceSize && sourceData[position] == '=') {
+                    position++;
+                    return { T_Symbols, start, 2 };
                 }
-                else {
-                    std::string tempStr = "";
-                    switch (parseChar(lineBuffer[charIndex])) {
-                        case C_Number:
-                        while (charIndex < lineBuffer.size() && parseChar(lineBuffer[charIndex]) == C_Number) {
-                            tempStr += lineBuffer[charIndex];
-                            charIndex++;
-                        }
-                        nextToken = { T_Number, lineIndex, tempStr};
-                        return;
-                        case C_Letter:
-                        while (charIndex < lineBuffer.size()
-                               && (parseChar(lineBuffer[charIndex]) == C_Number
-                                   || parseChar(lineBuffer[charIndex]) == C_Letter)) {
-                            tempStr += lineBuffer[charIndex];
-                            charIndex++;
-                        }
-                        if (keywordTable.find(tempStr) == keywordTable.end()) {
-                            nextToken = { T_Identifier, lineIndex, tempStr};
-                        }
-                        else {
-                            nextToken = { T_Keywords, lineIndex, tempStr};
-                        }
-                        return;
-                        case C_Apostrophe:
-                        tempStr += '\'';
-                        charIndex++;
-                        if (charIndex < lineBuffer.size()
-                            && parseChar(lineBuffer[charIndex]) == C_Backslash
-                            && charIndex + 2 < lineBuffer.size()
-                            && lineBuffer[charIndex + 1] == 'n' // recognize '\n' only
-                            && parseChar(lineBuffer[charIndex + 2]) == C_Apostrophe) {
-                            for (int i = 0; i < 3; i++) {
-                                tempStr += lineBuffer[charIndex];
-                                charIndex++;
-                            }
-                            nextToken = { T_Character, lineIndex, tempStr};
-                        }
-                        else if (charIndex < lineBuffer.size()
-                                 && parseChar(lineBuffer[charIndex]) != C_Apostrophe // not accept '''
-                                 && parseChar(lineBuffer[charIndex]) != C_Backslash  // not accept '\'
-                                 && charIndex + 1 < lineBuffer.size()
-                                 && parseChar(lineBuffer[charIndex + 1]) == C_Apostrophe) {
-                            for (int i = 0; i < 2; i++) {
-                                tempStr += lineBuffer[charIndex];
-                                charIndex++;
-                            }
-                            nextToken = { T_Character, lineIndex, tempStr};
-                        }
-                        else {
-                            nextToken = { T_Unknown, lineIndex, tempStr};
-                        }
-                        return;
-                        case C_ExclamationMark:
-                        charIndex++;
-                        if (charIndex < lineBuffer.size()
-                            && lineBuffer[charIndex] == '=') {
-                            charIndex++;
-                            nextToken = { T_Symbols, lineIndex, "!="};
-                        }
-                        else {
-                            nextToken = { T_Unknown, lineIndex, "!"};
-                        }
-                        return;
-                        case C_Symbol:
-                        tempStr += lineBuffer[charIndex];
-                        charIndex++;
-                        if (charIndex < lineBuffer.size()
-                            && parseChar(lineBuffer[charIndex]) == C_Symbol
-                            && twoCharSymbols.find(tempStr + lineBuffer[charIndex]) != twoCharSymbols.end()) {
-                            tempStr += lineBuffer[charIndex];
-                            charIndex++;
-                        }
-                        nextToken = { T_Symbols, lineIndex, tempStr};
-                        return;
-                        case C_Punctuation:
-                        tempStr += lineBuffer[charIndex];
-                        charIndex++;
-                        nextToken = { T_Punctuation, lineIndex, tempStr};
-                        return;
-                        case C_Slash:
-                        if (charIndex + 1 < lineBuffer.size() && parseChar(lineBuffer[charIndex + 1]) == C_Slash) {
-                            endLineFlag = true;
-                        }
-                        else {
-                            tempStr += lineBuffer[charIndex];
-                            charIndex++;
-                            nextToken = { T_Symbols, lineIndex, tempStr};
-                            return;
-                        }
-                        break;
-                        default:
-                        tempStr += lineBuffer[charIndex];
-                        charIndex++;
-                        nextToken = { T_Unknown, lineIndex, tempStr};
-                        return;
+                return { T_Unknown, start, 1 };
+                case C_Symbol:
+                position++;
+                if (position < sourceSize
+                    && parseChar(sourceData[position]) == C_Symbol
+                    && isTwoCharSymbol(sourceData[start], sourceData[position])) {
+                    position++;
+                }
+                return { T_Symbols, start, position - start };
+                case C_Punctuation:
+                position++;
+                return { T_Punctuation, start, 1 };
+                case C_Slash:
+                if (position + 1 < sourceSize && parseChar(sourceData[position + 1]) == C_Slash) {
+                    // skip the comment up to the end of the line
+                    while (position < sourceSize && sourceData[position] != '\n') {
+                        position++;
                     }
+                    break;
                 }
+                position++;
+                return { T_Symbols, start, 1 };
+                default:
+                position++;
+                return { T_Unknown, start, 1 };
             }
         }
     }
@@ -313,6 +433,15 @@ public:
     Token peekToken() {
         return nextToken;
     }
+    
+    // all tokens lexed so far, used to drive later passes without scanning the file again
+    const std::vector<TokenView> & getTokens() {
+        return tokens;
+    }
+    
+    std::shared_ptr<SourceFile> getSource() {
+        return source;
+    }
 };
 
 #endif /* scanner_h */
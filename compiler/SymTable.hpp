@@ -13,81 +13,95 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <map>
+#include <unordered_map>
+#include <algorithm>
+#include "Arena.hpp"
+#include "ICode.hpp"
+#include "CFG.hpp"
 
-enum ICODEOP {
-    ADD,
-    ADI,
-    SUB,
-    MUL,
-    DIV,
-    LT,
-    GT,
-    NE,
-    EQ,
-    LE,
-    GE,
-    AND,
-    OR,
-    BF,
-    BT,
-    JMP,
-    PUSH,
-    POP,
-    PEEK,
-    FRAME,
-    CALL,
-    RTN,
-    RETURN,
-    FUNC,
-    NEWI,
-    NEW,
-    MOV,
-    MOVI,
-    WRITE,
-    READ,
-    WRTC,
-    WRTI,
-    RDC,
-    RDI,
-    REF,
-    AEF,
-    STOP,
-    NOP
+enum SymKind {
+    K_None,
+    K_Zlit,
+    K_Ilit,
+    K_Clit,
+    K_Main,
+    K_Class,
+    K_Method,
+    K_Constructor,
+    K_Param,
+    K_Ivar,
+    K_Lvar,
+    K_Tvar,
+    K_Lval
 };
 
-struct QUAD {
-    int lineNumber;
-    ICODEOP opcode;
+enum SymTypeCode {
+    Y_None,
+    Y_Int,
+    Y_Char,
+    Y_Bool,
+    Y_Void,
+    Y_Null,
+    Y_Sym,
+    Y_Other  // class and array types
+};
+
+enum SymAccess {
+    A_None,
+    A_Public,
+    A_Private
+};
+
+// one line of target code, an empty opcode means a comment line
+struct TCODE {
+    std::string label;
+    std::string opcode;
     std::string operand1;
     std::string operand2;
-    std::string operand3;
-    std::string label;
+    std::string operand3;  // displacement of STRO, LDRO, STBO, LDBO or target of a fused branch, "" for the rest
+    std::string comment;
+    int iCodeIndex;  // comment line showing quad[iCodeIndex], -1 for none
 };
 
 class SymTable {
 private:
     int nextID = SYMID_START;
     int nullID, trueID, falseID, charSizeID, intSizeID, mainID;
-    std::map<int, std::string> symScope;
-    std::map<int, std::string> symID;
-    std::map<int, std::string> symValue;
-    std::map<int, std::string> symKind;
-    std::map<int, std::string> symType;
-    std::map<int, std::string> symReturnType;
-    std::map<int, std::string> symParam;
-    std::map<int, std::string> symAccessMod;
-    std::map<int, int> symOffset;
+    // symbol records, one slot per id from SYMID_START, strings are interned
+    std::vector<int> symScope;
+    std::vector<int> symID;
+    std::vector<int> symValue;
+    std::vector<SymKind> symKind;
+    std::vector<int> symType;
+    std::vector<SymTypeCode> symTypeCode;
+    std::vector<int> symReturnType;
+    std::vector<int> symParam;
+    std::vector<SymAccess> symAccessMod;
+    std::vector<int> symOffset;
+    std::vector<int> symRegister;  // register the allocator keeps the symbol in, -1 if it lives in memory
+    Arena arena;  // holds the interned strings for the whole compilation
+    std::vector<ArenaString> strings;  // interned strings, index 0 is ""
+    std::unordered_map<ArenaString, int, ArenaStringHash> stringIndex;  // string -> index in strings
+    std::unordered_map<long long, std::vector<int>> nameIndex;  // (scope, value) -> ids in ascending order
+    std::unordered_map<std::string, std::vector<int>> scopeChains;  // scope -> its interned scopes, innermost first, without "g"
     // for icode generator
     int iCodeCounter = 0;
     int labelCounter = 0;
+    std::vector<int> labelNames;  // label id -> interned name, id 0 is no label
+    std::vector<int> labelAlias;  // label id -> label it was merged into, itself if none
+    CFG cfg;
     std::vector<QUAD> quad;
     std::vector<QUAD> sQuad;
     bool isStaticInitICode = false;
-    std::vector<std::string> tCode;
+    std::vector<TCODE> tCode;
 
 public:
     SymTable() {
+        intern("");
+        labelNames.push_back(0);
+        labelAlias.push_back(0);
         nullID = insert("g", "Z", "null", "zlit", "null", "", "", "public", 0);
         trueID = insert("g", "Z", "true", "zlit", "bool", "", "", "public", 0);
         falseID = insert("g", "Z", "false", "zlit", "bool", "", "", "public", 0);
@@ -95,9 +109,9 @@ public:
         intSizeID = insert("g", "N", "4", "ilit", "int", "", "", "public", 0);
         mainID = insert("g.main", "F", "main", "main", "", "void", "[]", "public", 0);
 
-        iCode(0, FRAME, getSymID(mainID), "NULL", "", "");
-        iCode(0, CALL, getSymID(mainID), "", "", "");
-        iCode(0, STOP, "", "", "", "");
+        iCode(0, FRAME, opSym(mainID), opNull());
+        iCode(0, CALL, opSym(mainID));
+        iCode(0, STOP);
     }
     
     int insert(std::string scope,
@@ -110,85 +124,244 @@ public:
                 std::string accessMod,
                int offset) {
         std::string symid = idType + std::to_string(nextID);
-        symScope.insert(std::pair<int, std::string>(nextID, scope));
-        symID.insert(std::pair<int, std::string>(nextID, symid));
-        symValue.insert(std::pair<int, std::string>(nextID, value));
-        symKind.insert(std::pair<int, std::string>(nextID, kind));
-        symType.insert(std::pair<int, std::string>(nextID, type));
-        symReturnType.insert(std::pair<int, std::string>(nextID, returnType));
-        symParam.insert(std::pair<int, std::string>(nextID, parameter));
-        symAccessMod.insert(std::pair<int, std::string>(nextID, accessMod));
-        symOffset.insert(std::pair<int, int>(nextID, offset));
+        symScope.push_back(intern(scope));
+        symID.push_back(intern(symid));
+        symValue.push_back(intern(value));
+        symKind.push_back(kindCode(kind));
+        symType.push_back(intern(type));
+        symTypeCode.push_back(typeCode(type));
+        symReturnType.push_back(intern(returnType));
+        symParam.push_back(intern(parameter));
+        symAccessMod.push_back(accessCode(accessMod));
+        symOffset.push_back(offset);
+        symRegister.push_back(-1);
+        nameIndex[nameKey(symScope.back(), symValue.back())].push_back(nextID);
 
         nextID++;
         return nextID - 1;  //return the number id of the new symbol record
     }
     
+    int intern(const std::string & str) {
+        auto it = stringIndex.find({ str.data(), str.size() });
+        if (it != stringIndex.end()) return it->second;
+        ArenaString newString = { arena.copyString(str.data(), str.size()), str.size() };
+        strings.push_back(newString);
+        stringIndex.insert(std::pair<ArenaString, int>(newString, static_cast<int>(strings.size()) - 1));
+        return static_cast<int>(strings.size()) - 1;
+    }
+    
+    std::string getString(int index) {
+        return std::string(strings[index].data, strings[index].length);
+    }
+    
+    long long nameKey(int scopeIndex, int valueIndex) {
+        return (static_cast<long long>(scopeIndex) << 32) | static_cast<unsigned int>(valueIndex);
+    }
+    
+    // index of a string already interned, -1 if no symbol uses it
+    int findString(const std::string & str) {
+        auto it = stringIndex.find({ str.data(), str.size() });
+        return it == stringIndex.end() ? -1 : it->second;
+    }
+    
+    bool isValidID(int id) {
+        return id >= SYMID_START && id < nextID;
+    }
+    
+    // number of symbol slots, ids run from SYMID_START
+    int getSymbolCount() {
+        return nextID - SYMID_START;
+    }
+    
+    int getTrueID() {
+        return trueID;
+    }
+    
+    int getFalseID() {
+        return falseID;
+    }
+    
+    int getNullID() {
+        return nullID;
+    }
+    
+    // the int literal with this value, added to the table if no source literal has it
+    int intLiteral(int value) {
+        std::string valueStr = std::to_string(value);
+        int tempId = searchValue("g", valueStr);
+        if (tempId != 0 && getKindCode(tempId) == K_Ilit) return tempId;
+        return insert("g", "N", valueStr, "ilit", "int", "", "", "public", 0);
+    }
+    
+    SymKind kindCode(const std::string & kind) {
+        if (kind == "zlit") return K_Zlit;
+        if (kind == "ilit") return K_Ilit;
+        if (kind == "clit") return K_Clit;
+        if (kind == "main") return K_Main;
+        if (kind == "Class") return K_Class;
+        if (kind == "method") return K_Method;
+        if (kind == "Constructor") return K_Constructor;
+        if (kind == "param") return K_Param;
+        if (kind == "ivar") return K_Ivar;
+        if (kind == "lvar") return K_Lvar;
+        if (kind == "tvar") return K_Tvar;
+        if (kind == "lval") return K_Lval;
+        return K_None;
+    }
+    
+    std::string kindName(SymKind kind) {
+        switch (kind) {
+            case K_Zlit: return "zlit";
+            case K_Ilit: return "ilit";
+            case K_Clit: return "clit";
+            case K_Main: return "main";
+            case K_Class: return "Class";
+            case K_Method: return "method";
+            case K_Constructor: return "Constructor";
+            case K_Param: return "param";
+            case K_Ivar: return "ivar";
+            case K_Lvar: return "lvar";
+            case K_Tvar: return "tvar";
+            case K_Lval: return "lval";
+            default: return "";
+        }
+    }
+    
+    SymTypeCode typeCode(const std::string & type) {
+        if (type == "") return Y_None;
+        if (type == "int") return Y_Int;
+        if (type == "char") return Y_Char;
+        if (type == "bool") return Y_Bool;
+        if (type == "void") return Y_Void;
+        if (type == "null") return Y_Null;
+        if (type == "sym") return Y_Sym;
+        return Y_Other;
+    }
+    
+    SymAccess accessCode(const std::string & accessMod) {
+        if (accessMod == "public") return A_Public;
+        if (accessMod == "private") return A_Private;
+        return A_None;
+    }
+    
     void updateOffset(int id, int newOffset) {
-        symOffset[id] = newOffset;
+        if (isValidID(id)) symOffset[id - SYMID_START] = newOffset;
     }
     
     void updateParam(int id, std::string newParam) {
-        symParam[id] = newParam;
+        if (isValidID(id)) symParam[id - SYMID_START] = intern(newParam);
     }
     
     void updateName(int id) {
-        symValue[id] = symID[id];
+        if (!isValidID(id)) return;
+        int slot = id - SYMID_START;
+        std::vector<int> & oldIds = nameIndex[nameKey(symScope[slot], symValue[slot])];
+        oldIds.erase(std::find(oldIds.begin(), oldIds.end(), id));
+        symValue[slot] = symID[slot];
+        std::vector<int> & newIds = nameIndex[nameKey(symScope[slot], symValue[slot])];
+        newIds.insert(std::lower_bound(newIds.begin(), newIds.end(), id), id);
     }
     
     int searchValue(std::string scope, std::string value) {
-        for (auto it = symValue.begin(); it != symValue.end(); it++) {
-            if (it->second == value) {
-                if (symScope[it->first] == scope) {
-                    return it->first;
-                }
+        int scopeIndex = findString(scope);
+        int valueIndex = findString(value);
+        if (scopeIndex < 0 || valueIndex < 0) return 0;
+        return searchValue(scopeIndex, valueIndex);
+    }
+    
+    int searchValue(int scopeIndex, int valueIndex) {
+        auto it = nameIndex.find(nameKey(scopeIndex, valueIndex));
+        if (it == nameIndex.end() || it->second.empty()) return 0;
+        return it->second.front();  // lowest id, like a scan in id order
+    }
+    
+    // search value from scope outward, stopping before the global scope "g"
+    int searchScopeChain(std::string scope, std::string value) {
+        int valueIndex = findString(value);
+        if (valueIndex < 0) return 0;
+        auto it = scopeChains.find(scope);
+        if (it == scopeChains.end()) {
+            std::vector<int> chain;
+            std::string currentPath = scope;
+            while (currentPath != "g") {
+                chain.push_back(intern(currentPath));
+                currentPath = currentPath.substr(0, currentPath.find_last_of('.'));
             }
+            it = scopeChains.insert(std::pair<std::string, std::vector<int>>(scope, chain)).first;
+        }
+        for (int i = 0; i < static_cast<int>(it->second.size()); i++) {
+            int tempId = searchValue(it->second[i], valueIndex);
+            if (tempId != 0) return tempId;
         }
-        return 0; //return zero if not found
+        return 0;
     }
     
     int getClassIDFromObject(int id) {
         int tempId = searchValue("g", getType(id));
-        if (tempId != 0 && getKind(tempId) == "Class")
+        if (tempId != 0 && getKindCode(tempId) == K_Class)
             return tempId;
         else
             return 0;
     }
     
     std::string getScope(int id) {
-        return symScope[id];
+        return isValidID(id) ? getString(symScope[id - SYMID_START]) : "";
     }
     
     std::string getSymID(int id) {
-        return symID[id];
+        return isValidID(id) ? getString(symID[id - SYMID_START]) : "";
     }
     
     std::string getValue(int id) {
-        return symValue[id];
+        return isValidID(id) ? getString(symValue[id - SYMID_START]) : "";
     }
     
     std::string getKind(int id) {
-        return symKind[id];
+        return kindName(getKindCode(id));
+    }
+    
+    SymKind getKindCode(int id) {
+        return isValidID(id) ? symKind[id - SYMID_START] : K_None;
     }
     
     std::string getType(int id) {
-        return symType[id];
+        return isValidID(id) ? getString(symType[id - SYMID_START]) : "";
+    }
+    
+    SymTypeCode getTypeCode(int id) {
+        return isValidID(id) ? symTypeCode[id - SYMID_START] : Y_None;
     }
     
     std::string getReturnType(int id) {
-        return symReturnType[id];
+        return isValidID(id) ? getString(symReturnType[id - SYMID_START]) : "";
     }
     
     std::string getParam(int id) {
-        return symParam[id];
+        return isValidID(id) ? getString(symParam[id - SYMID_START]) : "";
     }
     
     std::string getAccessMod(int id) {
-        return symAccessMod[id];
+        switch (getAccessCode(id)) {
+            case A_Public: return "public";
+            case A_Private: return "private";
+            default: return "";
+        }
+    }
+    
+    SymAccess getAccessCode(int id) {
+        return isValidID(id) ? symAccessMod[id - SYMID_START] : A_None;
     }
     
     int getOffset(int id) {
-        return symOffset[id];
+        return isValidID(id) ? symOffset[id - SYMID_START] : 0;
+    }
+    
+    int getRegister(int id) {
+        return isValidID(id) ? symRegister[id - SYMID_START] : -1;
+    }
+    
+    void setRegister(int id, int reg) {
+        if (isValidID(id)) symRegister[id - SYMID_START] = reg;
     }
     
     void print(int id) {
@@ -223,39 +396,38 @@ public:
     }
     
     // icode generator
-    void iCode(int line, ICODEOP op, std::string opr1, std::string opr2, std::string opr3, std::string lbl) {
+    void iCode(int line, ICODEOP op, OPERAND opr1 = opNone(), OPERAND opr2 = opNone(), OPERAND opr3 = opNone(), int lbl = 0) {
+        QUAD newQuad = {line, op, opr1, opr2, opr3, lbl};
         if (isStaticInitICode) {
-            QUAD newQuad = {line, op, opr1, opr2, opr3, lbl};
             sQuad.push_back(newQuad);
         }
         else {
             iCodeCounter++;
             if (iCodeCounter > quad.size()) {
-                QUAD newQuad = {line, op, opr1, opr2, opr3, lbl};
                 quad.push_back(newQuad);
             }
             else {
                 quad[quad.size() - 1].lineNumber = line;
                 quad[quad.size() - 1].opcode = op;
-                quad[quad.size() - 1].operand1 = opr1;
-                quad[quad.size() - 1].operand2 = opr2;
-                quad[quad.size() - 1].operand3 = opr3;
-                if (lbl.size() > 0) {
-                    backPatching(quad[quad.size() - 1].label, lbl);
-                    quad[quad.size() - 1].label = lbl;
+                quad[quad.size() - 1].operand1 = newQuad.operand1;
+                quad[quad.size() - 1].operand2 = newQuad.operand2;
+                quad[quad.size() - 1].operand3 = newQuad.operand3;
+                if (newQuad.label != 0) {
+                    backPatching(quad[quad.size() - 1].label, newQuad.label);
+                    quad[quad.size() - 1].label = newQuad.label;
                 }
             }
         }
     }
     
-    void iCodeLabel(std::string lbl) {
+    void iCodeLabel(int label) {
         if (iCodeCounter + 1 > quad.size()) {
-            QUAD newQuad = {0, NOP, "", "", "", lbl};
+            QUAD newQuad = {0, NOP, opNone(), opNone(), opNone(), label};
             quad.push_back(newQuad);
         }
         else {
-            backPatching(quad[quad.size() - 1].label, lbl);
-            quad[quad.size() - 1].label = lbl;
+            backPatching(quad[quad.size() - 1].label, label);
+            quad[quad.size() - 1].label = label;
         }
     }
     
@@ -270,22 +442,65 @@ public:
         sQuad.clear();
     }
     
-    void backPatching(std::string findLabel, std::string replaceLabel) {
+    // jumps to findLabel now go to replaceLabel, the quads are rewritten by resolveLabels
+    void backPatching(int findLabel, int replaceLabel) {
+        if (findLabel != 0) labelAlias[findLabel] = replaceLabel;
+    }
+    
+    int resolveLabel(int label) {
+        while (labelAlias[label] != label) {
+            labelAlias[label] = labelAlias[labelAlias[label]];
+            label = labelAlias[label];
+        }
+        return label;
+    }
+    
+    void resolveLabels() {
         for (int i = 0; i < quad.size(); i++) {
-            if (quad[i].opcode == JMP && quad[i].operand1 == findLabel)
-                quad[i].operand1 = replaceLabel;
-            else if (quad[i].opcode == BF && quad[i].operand2 == findLabel)
-                quad[i].operand2 = replaceLabel;
-            else if (quad[i].opcode == BT && quad[i].operand2 == findLabel)
-                quad[i].operand2 = replaceLabel;
+            if (quad[i].operand1.kind == O_Label) quad[i].operand1.value = resolveLabel(quad[i].operand1.value);
+            if (quad[i].operand2.kind == O_Label) quad[i].operand2.value = resolveLabel(quad[i].operand2.value);
+            if (quad[i].operand3.kind == O_Label) quad[i].operand3.value = resolveLabel(quad[i].operand3.value);
         }
     }
     
+    void buildCFG() {
+        resolveLabels();
+        cfg.build(quad, static_cast<int>(labelNames.size()));
+    }
+    
+    CFG & getCFG() {
+        return cfg;
+    }
+    
+    std::vector<QUAD> & getICode() {
+        return quad;
+    }
+    
     int getNewLabelCount() {
         labelCounter++;
         return labelCounter;
     }
     
+    // a new label id, name is what the target code calls it
+    int newLabel(const std::string & name) {
+        labelNames.push_back(intern(name));
+        labelAlias.push_back(static_cast<int>(labelAlias.size()));
+        return static_cast<int>(labelNames.size()) - 1;
+    }
+    
+    int getLabelCount() {
+        return static_cast<int>(labelNames.size());
+    }
+    
+    std::string getLabelName(int label) {
+        return getString(labelNames[resolveLabel(label)]);
+    }
+    
+    // first letter of the symbol id, 'R' marks a reference variable
+    char getIDType(int id) {
+        return isValidID(id) ? strings[symID[id - SYMID_START]].data[0] : '\0';
+    }
+    
     std::string getICodeOpStr(ICODEOP iCodeOp) {
         switch (iCodeOp) {
             case ADD:
@@ -366,6 +581,9 @@ public:
             case NEW:
                 return "NEW   ";
                 break;
+            case DELETE:
+                return "DELETE";
+                break;
             case MOV:
                 return "MOV   ";
                 break;
@@ -405,17 +623,35 @@ public:
         }
     }
     
+    std::string printOperand(OPERAND opr) {
+        switch (opr.kind) {
+            case O_Sym:
+                return getSymID(opr.value);
+            case O_Imm:
+                return std::to_string(opr.value);
+            case O_Label:
+                return getLabelName(opr.value);
+            case O_This:
+                return "this";
+            case O_Null:
+                return "NULL";
+            default:
+                return "";
+        }
+    }
+    
+    // for dumps only, code generation reads the operands directly
     std::string printICode(QUAD code) {
         std::string result;
         result = "  " + std::to_string(code.lineNumber) + ":\t";
-        if (code.label.size() == 0)
+        if (code.label == 0)
             result += "        \t";
         else
-            result += code.label + "\t";
+            result += getLabelName(code.label) + "\t";
         result += getICodeOpStr(code.opcode) + "\t";
-        result += code.operand1 + "\t";
-        result += code.operand2 + "\t";
-        result += code.operand3 + "\t";
+        result += printOperand(code.operand1) + "\t";
+        result += printOperand(code.operand2) + "\t";
+        result += printOperand(code.operand3) + "\t";
         return result;
     }
     
@@ -435,98 +671,128 @@ public:
         return paramNum * 4;
     }
     
-    void loadDataCode(std::string symIdStr, std::string regName, std::string label) {
-        int symId = std::stoi(symIdStr.substr(1));
-        if (getKind(symId) == "ilit") {
-            tCode.push_back(label + "\t\tLDR\t\t" + regName + ", " + symIdStr);
+    void loadDataCode(OPERAND opr, std::string regName, std::string label) {
+        int symId = opr.value;
+        if (opr.kind == O_Sym && getRegister(symId) >= 0) {
+            tEmit(label, "MOV", regName, "R" + std::to_string(getRegister(symId)));
             return;
         }
-        else if (getKind(symId) == "clit") {
-            tCode.push_back(label + "\t\tLDB\t\t" + regName + ", " + symIdStr);
+        if (getKindCode(symId) == K_Ilit) {
+            tEmit(label, "LDR", regName, getSymID(symId));
             return;
         }
-        else if (getValue(symId) == "true") {
-            tCode.push_back(label + "\t\tLDR\t\t" + regName + ", TRUE1");
+        else if (getKindCode(symId) == K_Clit) {
+            tEmit(label, "LDB", regName, getSymID(symId));
             return;
         }
-        else if (getValue(symId) == "false") {
-            tCode.push_back(label + "\t\tLDR\t\t" + regName + ", FALSE0");
+        else if (symId == trueID) {
+            tEmit(label, "LDR", regName, "TRUE1");
             return;
         }
-        else if (getValue(symId) == "null") {
-            tCode.push_back(label + "\t\tSUB\t\t" + regName + ", " + regName);
+        else if (symId == falseID) {
+            tEmit(label, "LDR", regName, "FALSE0");
             return;
         }
-        else if (getKind(symId) == "ivar") {
-            tCode.push_back(label + "\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -8");
-            tCode.push_back("\t\t\t\tLDR\t\t" + regName + ", R0");
-            tCode.push_back("\t\t\t\tMOV\t\tR0, " + regName);
-            tCode.push_back("\t\t\t\tADI\t\tR0, " + std::to_string(getOffset(symId)));
+        else if (symId == nullID) {
+            tEmit(label, "SUB", regName, regName);
+            return;
         }
-        else if (symIdStr[0] == 'R') {
-            tCode.push_back(label + "\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
-            tCode.push_back("\t\t\t\tLDR\t\t" + regName + ", R0");
-            tCode.push_back("\t\t\t\tMOV\t\tR0, " + regName);
+        // the this pointer or the reference is loaded first, the value is read relative to it
+        std::string base = "FP";
+        int displacement = -getOffset(symId);
+        if (getKindCode(symId) == K_Ivar) {
+            tEmitOffset(label, "LDRO", regName, "FP", -8);
+            label = "";
+            base = regName;
+            displacement = getOffset(symId);
         }
-        else {
-            tCode.push_back(label + "\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
+        else if (getIDType(symId) == 'R') {
+            tEmitOffset(label, "LDRO", regName, "FP", -getOffset(symId));
+            label = "";
+            base = regName;
+            displacement = 0;
         }
-        if (getType(symId) == "char")
-            tCode.push_back("\t\t\t\tLDB\t\t" + regName + ", R0");
-        else
-            tCode.push_back("\t\t\t\tLDR\t\t" + regName + ", R0");
+        tEmitOffset(label, getTypeCode(symId) == Y_Char ? "LDBO" : "LDRO", regName, base, displacement);
     }
     
-    void storeDataCode(std::string symIdStr, std::string regName) {
-        int symId = std::stoi(symIdStr.substr(1));
-        if (getKind(symId) == "ivar") {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -8");
-            tCode.push_back("\t\t\t\tLDR\t\tR4, R0");
-            tCode.push_back("\t\t\t\tMOV\t\tR0, R4");
-            tCode.push_back("\t\t\t\tADI\t\tR0, " + std::to_string(getOffset(symId)));
+    void storeDataCode(OPERAND opr, std::string regName) {
+        int symId = opr.value;
+        if (opr.kind == O_Sym && getRegister(symId) >= 0) {
+            tEmit("", "MOV", "R" + std::to_string(getRegister(symId)), regName);
+            return;
         }
-        else if (symIdStr[0] == 'R') {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
-            tCode.push_back("\t\t\t\tLDR\t\tR4, R0");
-            tCode.push_back("\t\t\t\tMOV\t\tR0, R4");
+        std::string base = "FP";
+        int displacement = -getOffset(symId);
+        if (getKindCode(symId) == K_Ivar) {
+            tEmitOffset("", "LDRO", "R4", "FP", -8);
+            base = "R4";
+            displacement = getOffset(symId);
         }
-        else {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
+        else if (getIDType(symId) == 'R') {
+            tEmitOffset("", "LDRO", "R4", "FP", -getOffset(symId));
+            base = "R4";
+            displacement = 0;
         }
-        if (getType(symId) == "char")
-            tCode.push_back("\t\t\t\tSTB\t\t" + regName + ", R0");
-        else
-            tCode.push_back("\t\t\t\tSTR\t\t" + regName + ", R0");
-    }
-    
-    void getLocationCode(std::string symIdStr, std::string regName) {
-        int symId = std::stoi(symIdStr.substr(1));
-        if (getKind(symId) == "ivar") {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -8");
-            tCode.push_back("\t\t\t\tLDR\t\t" + regName + ", R0");
-            tCode.push_back("\t\t\t\tMOV\t\tR0, " + regName);
-            tCode.push_back("\t\t\t\tADI\t\tR0, " + std::to_string(getOffset(symId)));
-            tCode.push_back("\t\t\t\tMOV\t\t" + regName + ", R0");
+        tEmitOffset("", getTypeCode(symId) == Y_Char ? "STBO" : "STRO", regName, base, displacement);
+    }
+    
+    // register holding the value of opr, loaded into scratch unless the allocator
+    // already keeps it in one
+    std::string operandRegister(OPERAND opr, std::string scratch) {
+        if (opr.kind == O_Sym && getRegister(opr.value) >= 0) return "R" + std::to_string(getRegister(opr.value));
+        loadDataCode(opr, scratch, "");
+        return scratch;
+    }
+    
+    void getLocationCode(OPERAND opr, std::string regName) {
+        int symId = opr.value;
+        if (getKindCode(symId) == K_Ivar) {
+            tEmitOffset("", "LDRO", regName, "FP", -8);
+            tEmit("", "ADI", regName, std::to_string(getOffset(symId)));
         }
-        else if (symIdStr[0] == 'R') {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
-            tCode.push_back("\t\t\t\tLDR\t\t" + regName + ", R0");
+        else if (getIDType(symId) == 'R') {
+            tEmitOffset("", "LDRO", regName, "FP", -getOffset(symId));
         }
         else {
-            tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-            tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(symId)));
-            tCode.push_back("\t\t\t\tMOV\t\t" + regName + ", R0");
+            tEmit("", "MOV", regName, "FP");
+            tEmit("", "ADI", regName, "-" + std::to_string(getOffset(symId)));
         }
     }
     
+    void tEmit(std::string label, std::string opcode, std::string operand1, std::string operand2, std::string comment = "") {
+        tCode.push_back({ label, opcode, operand1, operand2, "", comment, -1 });
+    }
+
+    // base + displacement access: opcode reg, base, displacement
+    void tEmitOffset(std::string label, std::string opcode, std::string regName, std::string base, int displacement) {
+        tCode.push_back({ label, opcode, regName, base, std::to_string(displacement), "", -1 });
+    }
+
+    // fused compare and branch or FRAME: opcode reg1, reg2 or size, target
+    void tEmitBranch(std::string label, std::string opcode, std::string reg1, std::string reg2, std::string target) {
+        tCode.push_back({ label, opcode, reg1, reg2, target, "", -1 });
+    }
+
+    void tComment(std::string comment) {
+        tCode.push_back({ "", "", "", "", "", comment, -1 });
+    }
+
+    // the quad is only printed when the target code is saved
+    void tICodeComment(int index) {
+        tCode.push_back({ "", "", "", "", "", "", index });
+    }
+
+    std::string printTCode(TCODE code) {
+        if (code.opcode == "") return ";" + (code.iCodeIndex >= 0 ? printICode(quad[code.iCodeIndex]) : code.comment);
+        std::string line = (code.label == "" ? "\t\t" : code.label) + "\t\t" + code.opcode;
+        if (code.opcode[0] == '.') return line + "\t" + code.operand1;
+        if (code.operand1 != "") line += "\t\t" + code.operand1;
+        if (code.operand2 != "") line += ", " + code.operand2;
+        if (code.operand3 != "") line += ", " + code.operand3;
+        if (code.comment != "") line += "\t\t\t\t\t\t;" + code.comment;
+        return line;
+    }
+
     int getASCIIcode(std::string charLit) {
         if (charLit == "\'\\n\'") {
             return 10;
@@ -534,573 +800,608 @@ public:
         return charLit[1];
     }
     
+    // a relational quad whose temporary is only read by the BF right after it
+    bool feedsBranch(int i, const std::vector<int> & readCount) {
+        if (i + 1 >= static_cast<int>(quad.size()) || quad[i + 1].opcode != BF || quad[i + 1].label != 0) return false;
+        OPERAND result = quad[i].operand3;
+        return result.kind == O_Sym && quad[i + 1].operand1.kind == O_Sym && quad[i + 1].operand1.value == result.value
+            && getKindCode(result.value) == K_Tvar && readCount[result.value - SYMID_START] == 1;
+    }
+    
+    // compare the operands and take the BF branch at once, the boolean is never stored
+    void fusedBranchCode(int i) {
+        tICodeComment(i);
+        tICodeComment(i + 1);
+        std::string reg1 = "R1";
+        if (quad[i].label != 0)
+            loadDataCode(quad[i].operand1, reg1, getLabelName(quad[i].label));
+        else
+            reg1 = operandRegister(quad[i].operand1, "R1");
+        std::string reg2 = operandRegister(quad[i].operand2, "R2");
+        // BF jumps when the relation does not hold
+        std::string branch;
+        switch (quad[i].opcode) {
+            case LT: branch = "BGE"; break;
+            case GT: branch = "BLE"; break;
+            case EQ: branch = "BNE"; break;
+            case NE: branch = "BEQ"; break;
+            case LE: branch = "BGT"; break;
+            default: branch = "BLT"; break;
+        }
+        tEmitBranch("", branch, reg1, reg2, getLabelName(quad[i + 1].operand2.value));
+    }
+    
+    // registers the target code of a quad writes besides the variable it stores,
+    // bit n for Rn. The register allocator keeps no variable live across a quad in
+    // one of them, so every scratch register used by generateTCode must be listed here.
+    static int tCodeScratch(ICODEOP op) {
+        const int R1 = 2, R2 = 4, R3 = 8, R4 = 16, R6 = 64, R7 = 128;
+        switch (op) {
+            case ADD: case SUB: case MUL: case DIV: case AND: case OR:
+                return R1 | R2 | R4;
+            case LT: case GT: case NE: case EQ: case LE: case GE:
+                return R1 | R2 | R3 | R4;
+            case BF: case REF: case PUSH: return R1;
+            case PEEK: return R4 | R6;
+            case FRAME: return R6;
+            case CALL: return 0xFF;  // the callee may use any of R0-R7
+            case RETURN: return R7;
+            case WRITE: case WRTC: case WRTI: return R3;
+            case RDC: case RDI: return R3 | R4;
+            case NEWI: case NEW: return R3 | R4;
+            case DELETE: return R3;
+            case AEF: return R1 | R2 | R7;
+            case MOV: return R1 | R4;
+            case STOP: return R3;
+            default: return 0;
+        }
+    }
+    
     void generateTCode() {
+        buildCFG();
+        std::vector<int> readCount(getSymbolCount(), 0);
+        for (int i = 0; i < static_cast<int>(quad.size()); i++) {
+            for (int k = 0; k < 3; k++) {
+                OPERAND opr = k == 0 ? quad[i].operand1 : (k == 1 ? quad[i].operand2 : quad[i].operand3);
+                if (iCodeReads(quad[i].opcode, k) && opr.kind == O_Sym && isValidID(opr.value)) readCount[opr.value - SYMID_START]++;
+            }
+        }
         // generate global data
-        tCode.push_back("OverF\t\t.INT\t-999999");
-        tCode.push_back("UnderF\t\t.INT\t-111111");
-        tCode.push_back("FALSE0\t\t.INT\t0");
-        tCode.push_back("TRUE1\t\t.INT\t1");
-        tCode.push_back("newline\t\t.BYT\t10");
-        tCode.push_back("space\t\t.BYT\t32");
+        tEmit("OverF", ".INT", "-999999", "");
+        tEmit("UnderF", ".INT", "-111111", "");
+        tEmit("FALSE0", ".INT", "0", "");
+        tEmit("TRUE1", ".INT", "1", "");
+        tEmit("newline", ".BYT", "10", "");
+        tEmit("space", ".BYT", "32", "");
 
         for (int i = SYMID_START; i < nextID; i++) {
-            if (getKind(i) == "ilit") {
-                tCode.push_back(getSymID(i) + "\t\t.INT\t" + getValue(i));
+            if (getKindCode(i) == K_Ilit) {
+                tEmit(getSymID(i), ".INT", getValue(i), "");
             }
-            else if (getKind(i) == "clit") {
-                tCode.push_back(getSymID(i) + "\t\t.BYT\t" + std::to_string(getASCIIcode(getValue(i))));
+            else if (getKindCode(i) == K_Clit) {
+                tEmit(getSymID(i), ".BYT", std::to_string(getASCIIcode(getValue(i))), "");
             }
         }
 
         for (int i = 0; i < quad.size(); i++) {
+            if (isRelationalICode(quad[i].opcode) && feedsBranch(i, readCount)) {
+                fusedBranchCode(i);
+                i++;
+                continue;
+            }
             switch (quad[i].opcode) {
                 case ADD:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tADD\t\tR1, R2");
+                    tEmit("", "ADD", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case ADI:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
+                    tICodeComment(i);
                     
                 }
                     break;
                 case SUB:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tSUB\t\tR1, R2");
+                    tEmit("", "SUB", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case MUL:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tMUL\t\tR1, R2");
+                    tEmit("", "MUL", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
 
                 }
                     break;
                 case DIV:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tDIV\t\tR1, R2");
+                    tEmit("", "DIV", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
 
                 }
                     break;
                 case LT:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBLT\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BLT", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "FALSE0");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "TRUE1");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case GT:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBGT\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BGT", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "FALSE0");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "TRUE1");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case NE:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBRZ\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BRZ", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "TRUE1");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "FALSE0");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case EQ:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBNZ\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BNZ", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "TRUE1");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "FALSE0");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case LE:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBGT\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BGT", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "TRUE1");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "FALSE0");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case GE:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tCMP\t\tR1, R2");
+                    tEmit("", "CMP", "R1", operandRegister(quad[i].operand2, "R2"));
                     int labelCnt = getNewLabelCount();
                     std::string labelSKIPIF = "SKIPIF" + std::to_string(labelCnt);
                     std::string labelSKIPELSE = "SKIPELSE" + std::to_string(labelCnt);
-                    tCode.push_back("\t\t\t\tBLT\t\tR1, " + labelSKIPIF);
-                    tCode.push_back("\t\t\t\tLDR\t\tR3, TRUE1");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + labelSKIPELSE);
-                    tCode.push_back(labelSKIPIF + "\t\tLDR\t\tR3, FALSE0");
-                    tCode.push_back(labelSKIPELSE + "\t\tMOV\t\tR1, R3");
+                    tEmit("", "BLT", "R1", labelSKIPIF);
+                    tEmit("", "LDR", "R3", "TRUE1");
+                    tEmit("", "JMP", labelSKIPELSE, "");
+                    tEmit(labelSKIPIF, "LDR", "R3", "FALSE0");
+                    tEmit(labelSKIPELSE, "MOV", "R1", "R3");
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case AND:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tAND\t\tR1, R2");
+                    tEmit("", "AND", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case OR:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    loadDataCode(quad[i].operand2, "R2", "\t\t");
-                    tCode.push_back("\t\t\t\tOR\t\tR1, R2");
+                    tEmit("", "OR", "R1", operandRegister(quad[i].operand2, "R2"));
                     storeDataCode(quad[i].operand3, "R1");
                 }
                     break;
                 case BF:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    loadDataCode(quad[i].operand1, "R1", tempLabel);
-                    tCode.push_back("\t\t\t\tBRZ\t\tR1, " + quad[i].operand2);
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    if (getRegister(quad[i].operand1.value) >= 0) {
+                        tEmit(tempLabel, "BRZ", "R" + std::to_string(getRegister(quad[i].operand1.value)), getLabelName(quad[i].operand2.value));
+                    }
+                    else {
+                        loadDataCode(quad[i].operand1, "R1", tempLabel);
+                        tEmit("", "BRZ", "R1", getLabelName(quad[i].operand2.value));
+                    }
                 }
                     break;
                 case BT:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
+                    tICodeComment(i);
                     
                 }
                     break;
                 case JMP:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(tempLabel + "\t\tJMP\t\t" + quad[i].operand1);
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    tEmit(tempLabel, "JMP", getLabelName(quad[i].operand1.value), "");
                 }
                     break;
                 case PUSH:
                 {
-                    tCode.push_back("\t\t\t\tMOV\t\tR7, FP");
-                    tCode.push_back("\t\t\t\tADI\t\tFP, -4");
-                    tCode.push_back("\t\t\t\tLDR\t\tR6, FP");
-                    tCode.push_back("\t\t\t\tMOV\t\tFP, R6");
-                    tCode.push_back(";" + printICode(quad[i]));
-                    loadDataCode(quad[i].operand1, "R1", "\t\t");
-                    tCode.push_back("\t\t\t\tMOV\t\tFP, R7");
-                    tCode.push_back("\t\t\t\tSTR\t\tR1, SP");
-                    tCode.push_back("\t\t\t\tADI\t\tSP, -4");
+                    tICodeComment(i);
+                    tEmit("", "PUSH", operandRegister(quad[i].operand1, "R1"), "");
                 }
                     break;
                 case POP:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
+                    tICodeComment(i);
                     
                 }
                     break;
                 case PEEK:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(tempLabel + "\t\tLDR\t\tR6, SP");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    tEmit(tempLabel, "LDR", "R6", "SP");
                     storeDataCode(quad[i].operand1, "R6");
                 }
                     break;
                 case FRAME:
                 {
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(";" + printICode(quad[i]));
-                    int funcId = std::stoi(quad[i].operand1.substr(1));
-                    int paramSize = 12 + calculateParamSize(getParam(funcId));
-                    // Test for overflow
-                    tCode.push_back(tempLabel + "\t\tMOV\t\tR5, SP");
-                    tCode.push_back("\t\t\t\tADI\t\tR5, -" + std::to_string(paramSize));
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tBLT\t\tR5, OVERFLOW");
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    tICodeComment(i);
+                    int funcId = quad[i].operand1.value;
                     // Set 'this' pointer
-                    if (quad[i].operand2 == "NULL") {
+                    std::string thisReg = "R6";
+                    if (quad[i].operand2.kind == O_Null) {
                         // clear R6
-                        tCode.push_back("\t\t\t\tSUB\t\tR6, R6");
+                        tEmit(tempLabel, "SUB", "R6", "R6");
+                        tempLabel = "";
                     }
-                    else if (quad[i].operand2 == "this") {
+                    else if (quad[i].operand2.kind == O_This) {
                         // copy 'this' pointer to R6
-                        tCode.push_back("\t\t\t\tMOV\t\tR7, FP");
-                        tCode.push_back("\t\t\t\tADI\t\tR7, -8");
-                        tCode.push_back("\t\t\t\tLDR\t\tR6, R7");
+                        tEmitOffset(tempLabel, "LDRO", "R6", "FP", -8);
+                        tempLabel = "";
+                    }
+                    else if (quad[i].operand2.kind == O_Sym && getRegister(quad[i].operand2.value) >= 0) {
+                        thisReg = "R" + std::to_string(getRegister(quad[i].operand2.value));
                     }
                     else {
-                        loadDataCode(quad[i].operand2, "R6", "\t\t");
+                        loadDataCode(quad[i].operand2, "R6", tempLabel);
+                        tempLabel = "";
                     }
-                    // Save off current FP in a Register
-                    tCode.push_back("\t\t\t\tMOV\t\tR3, FP");
-                    // Point at Current Activation Record (FP = SP)
-                    tCode.push_back("\t\t\t\tMOV\t\tFP, SP");
-                    // Adjust Stack Pointer for Return Address
-                    tCode.push_back("\t\t\t\tADI\t\tSP, -4");
-                    // Store PFP to Top of Stack
-                    tCode.push_back("\t\t\t\tSTR\t\tR3, SP");
-                    // Adjust Stack Pointer for PFP
-                    tCode.push_back("\t\t\t\tADI\t\tSP, -4");
-                    // Store this pointer to Top of Stack
-                    tCode.push_back("\t\t\t\tSTR\t\tR6, SP");
-                    // Adjust Stack Pointer for this
-                    tCode.push_back("\t\t\t\tADI\t\tSP, -4");
+                    // Test for overflow of the whole activation record, store PFP and this,
+                    // FP still points at the caller's frame so the arguments are read from it
+                    tEmitBranch(tempLabel, "FRAME", thisReg, std::to_string(getOffset(funcId)), "OVERFLOW");
                 }
                     break;
                 case CALL:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    tCode.push_back("\t\t\t\tMOV\t\tR1, PC");
-                    tCode.push_back("\t\t\t\tADI\t\tR1, 36");
-                    tCode.push_back("\t\t\t\tSTR\t\tR1, FP");
-                    tCode.push_back("\t\t\t\tJMP\t\t" + quad[i].operand1);
+                    tICodeComment(i);
+                    int funcId = quad[i].operand1.value;
+                    // FP = SP + size of return address, PFP, this and the arguments, save the return address there
+                    tEmit("", "CALL", getSymID(funcId), std::to_string(12 + calculateParamSize(getParam(funcId))));
                 }
                     break;
                 case RTN:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    // De-allocate Current Activation Record
-                    tCode.push_back(tempLabel + "\t\tMOV\t\tSP, FP");
-                    // Test for Underflow (SP > SB)
-                    tCode.push_back("\t\t\t\tMOV\t\tR5, FP");
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SB");
-                    tCode.push_back("\t\t\t\tBGT\t\tR5, UNDERFLOW");
-                    // Load Return Address from the Frame
-                    tCode.push_back("\t\t\t\tLDR\t\tR5, FP");
-                    // Load PFP from the Frame
-                    tCode.push_back("\t\t\t\tMOV\t\tR6, FP");
-                    tCode.push_back("\t\t\t\tADI\t\tR6, -4");
-                    tCode.push_back("\t\t\t\tLDR\t\tFP, R6");
-                    // Jump using JMR to Return Address
-                    tCode.push_back("\t\t\t\tJMR\t\tR5");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    // De-allocate the Activation Record, test for Underflow and jump to the Return Address
+                    tEmit(tempLabel, "RET", "UNDERFLOW", "");
                 }
                     break;
                 case RETURN:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    // De-allocate Current Activation Record
-                    tCode.push_back(tempLabel + "\t\tMOV\t\tSP, FP");
-                    // Test for Underflow (SP > SB)
-                    tCode.push_back("\t\t\t\tMOV\t\tR5, FP");
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SB");
-                    tCode.push_back("\t\t\t\tBGT\t\tR5, UNDERFLOW");
-                    // Load Return Address from the Frame
-                    tCode.push_back("\t\t\t\tLDR\t\tR5, FP");
-                    // Store Return Value on Top of Stack
-                    if (quad[i].operand1 == "this") {
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    // the Return Value is left in the Return Address slot
+                    std::string valueReg = "R7";
+                    if (quad[i].operand1.kind == O_This) {
                         // copy 'this' pointer to the return area
-                        tCode.push_back("\t\t\t\tMOV\t\tR6, FP");
-                        tCode.push_back("\t\t\t\tADI\t\tR6, -8");
-                        tCode.push_back("\t\t\t\tLDR\t\tR7, R6");
-                        tCode.push_back("\t\t\t\tADI\t\tR6, 8");
-                        tCode.push_back("\t\t\t\tSTR\t\tR7, R6");
+                        tEmitOffset(tempLabel, "LDRO", "R7", "FP", -8);
+                        tempLabel = "";
+                    }
+                    else if (quad[i].operand1.kind == O_Sym && getRegister(quad[i].operand1.value) >= 0) {
+                        valueReg = "R" + std::to_string(getRegister(quad[i].operand1.value));
                     }
                     else {
-                        loadDataCode(quad[i].operand1, "R7", "\t\t");
-                        tCode.push_back("\t\t\t\tSTR\t\tR7, FP");
-                   }
-                    // Load PFP from the Frame
-                    tCode.push_back("\t\t\t\tMOV\t\tR6, FP");
-                    tCode.push_back("\t\t\t\tADI\t\tR6, -4");
-                    tCode.push_back("\t\t\t\tLDR\t\tFP, R6");
-                    // Jump using JMR to Return Address
-                    tCode.push_back("\t\t\t\tJMR\t\tR5");
+                        loadDataCode(quad[i].operand1, "R7", tempLabel);
+                        tempLabel = "";
+                    }
+                    tEmit(tempLabel, "RET", valueReg, "UNDERFLOW");
                 }
                     break;
                 case FUNC:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    int funcId = std::stoi(quad[i].operand1.substr(1));
+                    tICodeComment(i);
+                    int funcId = quad[i].operand1.value;
                     int funcBodySize = getOffset(funcId) - 12 - calculateParamSize(getParam(funcId));
-                    // Test for overflow
-                    tCode.push_back(quad[i].operand1 + "\t\tMOV\t\tR5, SP");
-                    tCode.push_back("\t\t\t\tADI\t\tR5, -" + std::to_string(funcBodySize));
-                    tCode.push_back("\t\t\t\tMOV\t\tR6, R5");
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tBLT\t\tR5, OVERFLOW");
-                    // Allocate space for Temporary and Local Variables
-                    tCode.push_back("\t\t\t\tMOV\t\tSP, R6");
+                    // Allocate space for Temporary and Local Variables, FRAME has tested for overflow
+                    tEmit(getSymID(funcId), "ADI", "SP", std::to_string(-funcBodySize));
                 }
                     break;
                 case NEWI:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(tempLabel + "\t\tMOV\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tADI\t\tR5, " + quad[i].operand1);
-                    tCode.push_back("\t\t\t\tMOV\t\tR6, R5");
-                    // Test for overflow
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SP");
-                    tCode.push_back("\t\t\t\tBGT\t\tR5, OVERFLOW");
-                    // return the allocated address and renew SL
-                    tCode.push_back("\t\t\t\tMOV\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tMOV\t\tSL, R6");
-                    storeDataCode(quad[i].operand2, "R5");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    // the VM's allocator returns the address in R3, 0 if the heap is full
+                    tEmit(tempLabel, "SUB", "R3", "R3");
+                    tEmit("", "ADI", "R3", std::to_string(quad[i].operand1.value));
+                    tEmit("", "TRP", "5", "");
+                    tEmit("", "BRZ", "R3", "OVERFLOW");
+                    storeDataCode(quad[i].operand2, "R3");
                 }
                     break;
                 case NEW:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    loadDataCode(quad[i].operand1, "R7", tempLabel);
-                    tCode.push_back("\t\t\t\tMOV\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tADD\t\tR5, R7");
-                    tCode.push_back("\t\t\t\tMOV\t\tR6, R5");
-                    // Test for overflow
-                    tCode.push_back("\t\t\t\tCMP\t\tR5, SP");
-                    tCode.push_back("\t\t\t\tBGT\t\tR5, OVERFLOW");
-                    // return the allocated address and renew SL
-                    tCode.push_back("\t\t\t\tMOV\t\tR5, SL");
-                    tCode.push_back("\t\t\t\tMOV\t\tSL, R6");
-                    storeDataCode(quad[i].operand2, "R5");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    loadDataCode(quad[i].operand1, "R3", tempLabel);
+                    tEmit("", "TRP", "5", "");
+                    tEmit("", "BRZ", "R3", "OVERFLOW");
+                    storeDataCode(quad[i].operand2, "R3");
+                }
+                    break;
+                case DELETE:
+                {
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    // hand the block back to the VM's allocator, null is ignored
+                    loadDataCode(quad[i].operand1, "R3", tempLabel);
+                    tEmit("", "TRP", "6", "");
                 }
                     break;
                 case MOV:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R1", tempLabel);
                     storeDataCode(quad[i].operand2, "R1");
                 }
                     break;
                 case MOVI:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
+                    tICodeComment(i);
                     
                 }
                     break;
                 case WRITE:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R3", tempLabel);
-                    tCode.push_back("\t\t\t\tTRP\t\t1");
+                    tEmit("", "TRP", "1", "");
                 }
                     break;
                 case READ:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
+                    tICodeComment(i);
                     
                 }
                     break;
                 case WRTC:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R3", tempLabel);
-                    tCode.push_back("\t\t\t\tTRP\t\t3");
+                    tEmit("", "TRP", "3", "");
                 }
                     break;
                 case WRTI:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand1, "R3", tempLabel);
-                    tCode.push_back("\t\t\t\tTRP\t\t1");
+                    tEmit("", "TRP", "1", "");
                 }
                     break;
                 case RDC:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(tempLabel +"\t\tTRP\t\t4");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    tEmit(tempLabel, "TRP", "4", "");
                     storeDataCode(quad[i].operand1, "R3");
                 }
                     break;
                 case RDI:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    tCode.push_back(tempLabel +"\t\tTRP\t\t2");
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    tEmit(tempLabel, "TRP", "2", "");
                     storeDataCode(quad[i].operand1, "R3");
                 }
                     break;
                 case REF:
                 {
-                    int tId = std::stoi(quad[i].operand3.substr(1));
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
-                    if (quad[i].operand1 == "this") {
-                        tCode.push_back(tempLabel + "\t\tMOV\t\tR0, FP");
-                        tCode.push_back("\t\t\t\tADI\t\tR0, -8");
-                        tCode.push_back("\t\t\t\tLDR\t\tR1, R0");
+                    int tId = quad[i].operand3.value;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
+                    if (quad[i].operand1.kind == O_This) {
+                        tEmitOffset(tempLabel, "LDRO", "R1", "FP", -8);
                     }
                     else {
                         loadDataCode(quad[i].operand1, "R1", tempLabel);
                     }
-                    tCode.push_back("\t\t\t\tADI\t\tR1, " + std::to_string(getOffset(std::stoi(quad[i].operand2.substr(1)))));
+                    tEmit("", "ADI", "R1", std::to_string(getOffset(quad[i].operand2.value)));
                     // store the address on R1 to a Reference variable
-                    tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-                    tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(tId)));
-                    tCode.push_back("\t\t\t\tSTR\t\tR1, R0");
+                    tEmitOffset("", "STRO", "R1", "FP", -getOffset(tId));
                 }
                     break;
                 case AEF:
                 {
-                    int tId = std::stoi(quad[i].operand3.substr(1));
-                    tCode.push_back(";" + printICode(quad[i]));
-                    std::string tempLabel = "\t\t";
-                    if (quad[i].label != "") tempLabel = quad[i].label;
+                    int tId = quad[i].operand3.value;
+                    tICodeComment(i);
+                    std::string tempLabel = "";
+                    if (quad[i].label != 0) tempLabel = getLabelName(quad[i].label);
                     loadDataCode(quad[i].operand2, "R2", tempLabel);
-                    loadDataCode(quad[i].operand1, "R1", "\t\t");
-                    tCode.push_back("\t\t\t\tSUB\t\tR7, R7");
-                    if (getType(tId) == "char") {
-                        tCode.push_back("\t\t\t\tADI\t\tR7, 1");
+                    loadDataCode(quad[i].operand1, "R1", "");
+                    tEmit("", "SUB", "R7", "R7");
+                    if (getTypeCode(tId) == Y_Char) {
+                        tEmit("", "ADI", "R7", "1");
                     }
                     else {
-                        tCode.push_back("\t\t\t\tADI\t\tR7, 4");
+                        tEmit("", "ADI", "R7", "4");
                     }
-                    tCode.push_back("\t\t\t\tMUL\t\tR2, R7");
-                    tCode.push_back("\t\t\t\tADD\t\tR1, R2");
+                    tEmit("", "MUL", "R2", "R7");
+                    tEmit("", "ADD", "R1", "R2");
                     // store the address on R1 to a Reference variable
-                    tCode.push_back("\t\t\t\tMOV\t\tR0, FP");
-                    tCode.push_back("\t\t\t\tADI\t\tR0, -" + std::to_string(getOffset(tId)));
-                    tCode.push_back("\t\t\t\tSTR\t\tR1, R0");
+                    tEmitOffset("", "STRO", "R1", "FP", -getOffset(tId));
                 }
                     break;
                 case STOP:
                 {
-                    tCode.push_back(";" + printICode(quad[i]));
-                    tCode.push_back("\t\t\t\tLDB\t\tR3, newline");
-                    tCode.push_back("\t\t\t\tTRP\t\t3");
-                    tCode.push_back("\t\t\t\tTRP\t\t0");
+                    tICodeComment(i);
+                    tEmit("", "LDB", "R3", "newline");
+                    tEmit("", "TRP", "3", "");
+                    tEmit("", "TRP", "0", "");
                 }
                     break;
                 default:
-                    tCode.push_back("\t\t\t\tNOP\t\t\t\t\t\t;SOME ERROR HAPPENED");
+                    tEmit("", "NOP", "", "", "SOME ERROR HAPPENED");
                     break;
             }
         }
         // generate overflow checking code
-        tCode.push_back("OVERFLOW\t\tLDB\t\tR3, newline");
-        tCode.push_back("\t\t\t\tTRP\t\t3");
-        tCode.push_back("\t\t\t\tLDR\t\tR3, OverF");
-        tCode.push_back("\t\t\t\tTRP\t\t1");
-        tCode.push_back("\t\t\t\tLDB\t\tR3, newline");
-        tCode.push_back("\t\t\t\tTRP\t\t3");
-        tCode.push_back("\t\t\t\tTRP\t\t0");
+        tEmit("OVERFLOW", "LDB", "R3", "newline");
+        tEmit("", "TRP", "3", "");
+        tEmit("", "LDR", "R3", "OverF");
+        tEmit("", "TRP", "1", "");
+        tEmit("", "LDB", "R3", "newline");
+        tEmit("", "TRP", "3", "");
+        tEmit("", "TRP", "0", "");
         // generate underflow checking code
-        tCode.push_back("UNDERFLOW\t\tLDB\t\tR3, newline");
-        tCode.push_back("\t\t\t\tTRP\t\t3");
-        tCode.push_back("\t\t\t\tLDR\t\tR3, OverF");
-        tCode.push_back("\t\t\t\tTRP\t\t1");
-        tCode.push_back("\t\t\t\tLDB\t\tR3, UnderF");
-        tCode.push_back("\t\t\t\tTRP\t\t3");
-        tCode.push_back("\t\t\t\tTRP\t\t0");
-
-        saveTCodeTofile();
+        tEmit("UNDERFLOW", "LDB", "R3", "newline");
+        tEmit("", "TRP", "3", "");
+        tEmit("", "LDR", "R3", "OverF");
+        tEmit("", "TRP", "1", "");
+        tEmit("", "LDB", "R3", "UnderF");
+        tEmit("", "TRP", "3", "");
+        tEmit("", "TRP", "0", "");
+    }
+    
+    std::vector<TCODE> & getTCode() {
+        return tCode;
     }
     
-    void saveTCodeTofile() {
+    void saveTCodeTofile(std::string fileName) {
         std::ofstream targetFile;
-        targetFile.open ("tcode.asm", std::ios::out | std::ios::trunc);
+        targetFile.open (fileName, std::ios::out | std::ios::trunc);
         for (int i = 0; i < tCode.size(); i++) {
-            targetFile << tCode[i];
+            targetFile << printTCode(tCode[i]);
             targetFile << "\n";
         }
         targetFile.close();
     }
+    
+    // target code split into the tokens the assembler reads, one entry per line
+    // of the saved file (comment lines are empty) so line numbers stay the same
+    std::vector<std::vector<std::string>> getTokenizedTCode() {
+        std::vector<std::vector<std::string>> lines;
+        for (int i = 0; i < static_cast<int>(tCode.size()); i++) {
+            std::vector<std::string> tokens;
+            if (tCode[i].opcode != "") {
+                if (tCode[i].label != "") tokens.push_back(tCode[i].label);
+                tokens.push_back(tCode[i].opcode);
+                if (tCode[i].operand3 != "") {
+                    tokens.push_back(tCode[i].operand1 + ",");
+                    tokens.push_back(tCode[i].operand2 + ",");
+                    tokens.push_back(tCode[i].operand3);
+                }
+                else if (tCode[i].operand2 != "") {
+                    tokens.push_back(tCode[i].operand1 + ",");
+                    tokens.push_back(tCode[i].operand2);
+                }
+                else if (tCode[i].operand1 != "") {
+                    tokens.push_back(tCode[i].operand1);
+                }
+            }
+            lines.push_back(tokens);
+        }
+        return lines;
+    }
 };
 
 #endif /* SymTable_h */
@@ -0,0 +1,241 @@
+//
+//  jit.hpp
+//  compiler
+//
+
+#ifndef jit_hpp
+#define jit_hpp
+
+#include <vector>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define VM_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+// x86-64 register numbers
+#define X_RAX 0
+#define X_RCX 1
+#define X_RDX 2
+#define X_RBX 3
+#define X_RSP 4
+#define X_RBP 5
+#define X_RSI 6
+#define X_RDI 7
+#define X_R8 8
+#define X_R9 9
+#define X_R10 10
+#define X_R11 11
+#define X_R12 12
+#define X_R13 13
+#define X_R14 14
+#define X_R15 15
+// x86-64 condition codes, used as 0x0F 0x80+cc for Jcc and 0x0F 0x90+cc for SETcc
+#define X_CC_AE 0x3
+#define X_CC_Z 0x4
+#define X_CC_NZ 0x5
+#define X_CC_BE 0x6
+#define X_CC_A 0x7
+#define X_CC_L 0xC
+#define X_CC_GE 0xD
+#define X_CC_LE 0xE
+#define X_CC_G 0xF
+
+// a small x86-64 machine code emitter, only the instructions the VM JIT needs.
+// Register-memory forms address VM memory as [RBP + disp32] or [RBP + RAX].
+class X86Emitter {
+private:
+    std::vector<unsigned char> code;
+
+    void rex(bool w, int reg, int index, int base, bool force) {
+        unsigned char prefix = 0x40 | (w ? 8 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+        if (prefix != 0x40 || force) code.push_back(prefix);
+    }
+
+    void modrm(int mod, int reg, int rm) {
+        code.push_back(static_cast<unsigned char>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+public:
+    int size() {
+        return static_cast<int>(code.size());
+    }
+
+    const unsigned char * data() {
+        return code.data();
+    }
+
+    void byte(int value) {
+        code.push_back(static_cast<unsigned char>(value));
+    }
+
+    void int32(int value) {
+        unsigned char bytes[4];
+        std::memcpy(bytes, & value, 4);
+        code.insert(code.end(), bytes, bytes + 4);
+    }
+
+    void int64(const void * value) {
+        unsigned char bytes[8];
+        std::memcpy(bytes, & value, 8);
+        code.insert(code.end(), bytes, bytes + 8);
+    }
+
+    // overwrite a rel32 written earlier so that it jumps to target
+    void patchRel32(int at, int target) {
+        int rel = target - (at + 4);
+        std::memcpy(& code[at], & rel, 4);
+    }
+
+    // op r/m32, r32 (or op r32, r/m32 for loads) between two registers
+    void regReg(int opcode, int reg, int rm) {
+        rex(false, reg, 0, rm, false);
+        byte(opcode);
+        modrm(3, reg, rm);
+    }
+
+    // two byte opcode 0x0F op between two registers
+    void regReg0F(int opcode, int reg, int rm) {
+        rex(false, reg, 0, rm, false);
+        byte(0x0F);
+        byte(opcode);
+        modrm(3, reg, rm);
+    }
+
+    // op with [RBP + disp32]; byteReg forces a REX prefix so SIL/DIL are used instead of DH/BH
+    void regAbs(int opcode, int reg, int disp, bool byteReg) {
+        rex(false, reg, 0, X_RBP, byteReg && reg >= 4);
+        byte(opcode);
+        modrm(2, reg, X_RBP);
+        int32(disp);
+    }
+
+    // op with [RBP + RAX]
+    void regIndexed(int opcode, int reg, bool byteReg) {
+        rex(false, reg, X_RAX, X_RBP, byteReg && reg >= 4);
+        byte(opcode);
+        modrm(1, reg, 4);
+        byte((0 << 6) | (X_RAX << 3) | X_RBP);
+        byte(0);
+    }
+
+    // movsx r32, byte [RBP + disp32]
+    void movsxAbs(int reg, int disp) {
+        rex(false, reg, 0, X_RBP, false);
+        byte(0x0F);
+        byte(0xBE);
+        modrm(2, reg, X_RBP);
+        int32(disp);
+    }
+
+    // movsx r32, byte [RBP + RAX]
+    void movsxIndexed(int reg) {
+        rex(false, reg, X_RAX, X_RBP, false);
+        byte(0x0F);
+        byte(0xBE);
+        modrm(1, reg, 4);
+        byte((0 << 6) | (X_RAX << 3) | X_RBP);
+        byte(0);
+    }
+
+    // movsxd RAX, r32
+    void movsxdRax(int reg) {
+        rex(true, X_RAX, 0, reg, false);
+        byte(0x63);
+        modrm(3, X_RAX, reg);
+    }
+
+    // mov r32, imm32
+    void movImm(int reg, int value) {
+        rex(false, 0, 0, reg, false);
+        byte(0xB8 + (reg & 7));
+        int32(value);
+    }
+
+    // mov r64, imm64
+    void movImm64(int reg, const void * value) {
+        rex(true, 0, 0, reg, false);
+        byte(0xB8 + (reg & 7));
+        int64(value);
+    }
+
+    // add r32, imm32
+    void addImm(int reg, int value) {
+        rex(false, 0, 0, reg, false);
+        byte(0x81);
+        modrm(3, 0, reg);
+        int32(value);
+    }
+
+    // cmp r32, imm32
+    void cmpImm(int reg, int value) {
+        rex(false, 0, 0, reg, false);
+        byte(0x81);
+        modrm(3, 7, reg);
+        int32(value);
+    }
+
+    // mov [base + disp8], r32 and mov r32, [base + disp8]
+    void storeDisp8(int reg, int base, int disp) {
+        rex(false, reg, 0, base, false);
+        byte(0x89);
+        modrm(1, reg, base);
+        byte(disp);
+    }
+
+    void loadDisp8(int reg, int base, int disp) {
+        rex(false, reg, 0, base, false);
+        byte(0x8B);
+        modrm(1, reg, base);
+        byte(disp);
+    }
+
+    // setcc r8, for RAX/RCX/RDX/RBX only
+    void setcc(int cc, int reg) {
+        byte(0x0F);
+        byte(0x90 + cc);
+        modrm(3, 0, reg);
+    }
+
+    // movzx r32, AL
+    void movzxAl(int reg) {
+        rex(false, reg, 0, X_RAX, false);
+        byte(0x0F);
+        byte(0xB6);
+        modrm(3, reg, X_RAX);
+    }
+
+    // idiv r32
+    void idiv(int reg) {
+        rex(false, 0, 0, reg, false);
+        byte(0xF7);
+        modrm(3, 7, reg);
+    }
+
+    void push(int reg) {
+        rex(false, 0, 0, reg, false);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(int reg) {
+        rex(false, 0, 0, reg, false);
+        byte(0x58 + (reg & 7));
+    }
+
+    // jmp/jcc rel32, return the offset of the rel32 to patch
+    int jmp() {
+        byte(0xE9);
+        int32(0);
+        return size() - 4;
+    }
+
+    int jcc(int cc) {
+        byte(0x0F);
+        byte(0x80 + cc);
+        int32(0);
+        return size() - 4;
+    }
+};
+
+#endif /* jit_hpp */
@@ -7,16 +7,119 @@
 //
 
 #include <iostream>
+#include <string>
+// Compiler.hpp must come first: vm.hpp defines its opcodes as macros (ADD, MOV, ...)
+// which would clash with the ICODEOP names used by SymTable.hpp
 #include "Compiler.hpp"
+#include "vm.hpp"
 
 using namespace std;
 
+VM * newConfiguredVM(long long memorySize, bool guard, string dispatchMode) {
+    VM * newVM = new VM(static_cast<int>(memorySize));
+    if (guard && !newVM->setGuard(true)) {
+        cout << "Guard pages are not available, every call tests for overflow itself." << endl;
+    }
+    if (dispatchMode == "threaded") newVM->setDispatchMode(D_Threaded);
+    if (dispatchMode == "jit") newVM->setDispatchMode(D_JIT);
+    if (dispatchMode == "profile") newVM->setDispatchMode(D_Profile);
+    return newVM;
+}
+
 int main(int argc, const char * argv[]) {
     if (argc < 2) {
-        cout << "Please input the KXI source file name in the command line." << endl;
+        cout << "Please input the KXI source file name in the command line, or -image <file> to run a program image." << endl;
+        cout << "Add -O1 to optimize, -O2 to also allocate registers, -peephole to only clean up the target code," << endl;
+        cout << "-run [switch|threaded|jit] to execute it without writing tcode.asm," << endl;
+        cout << "-run profile to also report the instruction sequences worth fusing," << endl;
+        cout << "-mem <bytes> to give the program more or less than " << MEM_SIZE << " bytes of memory," << endl;
+        cout << "-trusted to run the compiled program without bound checks on its stack and frame slots," << endl;
+        cout << "-guard to catch stack overflow with guard pages instead of a test in every call," << endl;
+        cout << "-guard keeps the heap " << GUARD_SIZE << " bytes and up to a page further from the stack," << endl;
+        cout << "-emit-c <file> to translate the program to a standalone C file," << endl;
+        cout << "-emit-image <file> to write the assembled program as an image for -image." << endl;
+        return 0;
+    }
+    int optimizationLevel = 0;
+    bool peephole = false;
+    bool runMode = false;
+    bool guard = false;
+    bool trusted = false;
+    string dispatchMode = "switch";
+    string cFileName = "";
+    string imageOutFileName = "";
+    string imageFileName = "";
+    long long memorySize = MEM_SIZE;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.size() >= 2 && arg.substr(0, 2) == "-O") {
+            optimizationLevel = arg.size() > 2 ? atoi(arg.c_str() + 2) : 1;
+        }
+        else if (arg == "-peephole") {
+            peephole = true;
+        }
+        else if (arg == "-guard") {
+            guard = true;
+        }
+        else if (arg == "-trusted") {
+            trusted = true;
+        }
+        else if (arg == "-run") {
+            runMode = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') dispatchMode = argv[++i];
+        }
+        else if (arg == "-emit-c" && i + 1 < argc) {
+            cFileName = argv[++i];
+        }
+        else if (arg == "-emit-image" && i + 1 < argc) {
+            imageOutFileName = argv[++i];
+        }
+        else if (arg == "-image" && i + 1 < argc) {
+            imageFileName = argv[++i];
+        }
+        else if (arg == "-mem" && i + 1 < argc) {
+            memorySize = atoll(argv[++i]);
+            if (memorySize < MEM_MIN_SIZE || memorySize > MEM_MAX_SIZE) {
+                cout << "Memory size must be between " << MEM_MIN_SIZE << " and " << MEM_MAX_SIZE << " bytes." << endl;
+                return 0;
+            }
+        }
+    }
+
+    if (imageFileName != "") {
+        // run an image written by -emit-image, without compiling or assembling anything.
+        // It may come from anywhere, so it is loaded and run with every check on.
+        VM * newVM = newConfiguredVM(memorySize, guard, dispatchMode);
+        if (newVM->loadImage(imageFileName)) {
+            if (cFileName != "") newVM->saveCSource(cFileName);
+            newVM->run();
+        }
+        delete newVM;
+    }
+    else if (runMode || cFileName != "" || imageOutFileName != "") {
+        // compile and hand the target code to the VM in memory
+        VM * newVM = newConfiguredVM(memorySize, guard, dispatchMode);
+        vector<vector<string>> targetCode;
+        {
+            // everything the compiler allocated is freed here, before the program runs
+            Compiler newCompiler = Compiler(argv[1]);
+            newCompiler.setOptimizationLevel(optimizationLevel);
+            if (peephole) newCompiler.setPeephole(true);
+            newCompiler.run("");
+            targetCode = newCompiler.getTargetCode();
+        }
+        if (trusted) newVM->setTrusted(true);  // the target code comes from our own compiler
+        if (newVM->assemble(targetCode)) {
+            if (cFileName != "") newVM->saveCSource(cFileName);
+            if (imageOutFileName != "") newVM->saveImage(imageOutFileName, true);
+            if (runMode) newVM->run();
+        }
+        delete newVM;
     }
     else {
         Compiler newCompiler = Compiler(argv[1]);
+        newCompiler.setOptimizationLevel(optimizationLevel);
+        if (peephole) newCompiler.setPeephole(true);
         newCompiler.run();
     }
 
@@ -0,0 +1,113 @@
+#!/bin/sh
+#
+#  regression.sh
+#  compiler
+#
+#  Runs the sample programs through the driver modes and compares their output.
+#  Usage, from this directory: sh regression.sh [C++ compiler] [C compiler]
+#
+
+CXX=${1:-c++}
+CC=${2:-cc}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failed=0
+
+# check name expected actual
+check() {
+    if [ "$2" = "$3" ]; then
+        echo "ok      $1"
+    else
+        echo "FAILED  $1"
+        failed=1
+    fi
+}
+
+$CXX -std=c++17 -O2 -o "$WORK/kxi" main.cpp || exit 1
+
+# input sample: fixed input for the sample
+input() {
+    case $1 in
+        fib) echo "20 12 1 0" ;;
+        prime) echo "1000 0" ;;
+        sort) echo "the quick brown fox jumps over the lazy dog" ;;
+        binary) echo "50 20 70 10 30 60 80 0" ;;
+    esac
+}
+
+# -O1, -O2 and -peephole: optimized code prints what the plain code prints on every engine
+for sample in fib prime sort binary; do
+    for mode in switch threaded jit; do
+        expected=$(input $sample | "$WORK/kxi" $sample.kxi -run $mode)
+        for level in "-O1" "-O2" "-O2 -peephole"; do
+            check "-run $mode $level $sample.kxi" "$expected" "$(input $sample | "$WORK/kxi" $sample.kxi -run $mode $level)"
+        done
+    done
+done
+
+# -emit-c: the C translation, built by the host compiler, prints what the VM prints
+for sample in fib prime sort; do
+    expected=$(echo "25 0" | "$WORK/kxi" $sample.kxi -run)
+    "$WORK/kxi" $sample.kxi -emit-c "$WORK/$sample.c" > /dev/null
+    $CC -O2 -o "$WORK/$sample" "$WORK/$sample.c" 2> /dev/null
+    check "-emit-c $sample.kxi" "$expected" "$(echo "25 0" | "$WORK/$sample")"
+done
+
+# -emit-image and -image: the image runs like the program it was assembled from
+expected=$(echo "25 0" | "$WORK/kxi" sort.kxi -run)
+"$WORK/kxi" sort.kxi -emit-image "$WORK/sort.img"
+check "-image sort.kxi" "$expected" "$(echo "25 0" | "$WORK/kxi" -image "$WORK/sort.img")"
+
+# VM_NO_COMPUTED_GOTO: the call-threaded engine runs like the computed-goto one
+$CXX -std=c++17 -O2 -DVM_NO_COMPUTED_GOTO -o "$WORK/kxi-call" main.cpp || exit 1
+for sample in fib prime sort binary; do
+    expected=$(echo "25 0" | "$WORK/kxi" $sample.kxi -run threaded)
+    check "VM_NO_COMPUTED_GOTO -run threaded $sample.kxi" "$expected" "$(echo "25 0" | "$WORK/kxi-call" $sample.kxi -run threaded)"
+done
+
+# -trusted keeps the bound checks on array elements: a store far out of range is a VM error
+printf 'void kxi2019 main() {\n\tint a[] = new int[2];\n\ta[100000000] = 1;\n}\n' > "$WORK/bounds.kxi"
+for mode in switch threaded jit; do
+    check "-run $mode -trusted array bounds" "Memory Access Error!" "$("$WORK/kxi" "$WORK/bounds.kxi" -run $mode -trusted)"
+done
+
+# -guard leaves the heap all but the guard pages: 70000 list nodes still fit
+printf 'class Node {\n\tpublic Node next;\n}\n\nvoid kxi2019 main() {\n\tint i = 0;\n\tNode head;\n\tNode t;\n\twhile (i < 70000) {\n\t\tt = new Node();\n\t\tt.next = head;\n\t\thead = t;\n\t\ti = i + 1;\n\t}\n\tcout << i;\n}\n' > "$WORK/heap.kxi"
+for mode in switch jit; do
+    check "-run $mode -guard heap" "70000" "$("$WORK/kxi" "$WORK/heap.kxi" -run $mode -guard)"
+done
+
+# large arrays cost their size, not the next power of two: prime.kxi runs near its stated limit
+"$WORK/kxi" prime.kxi -emit-c "$WORK/prime.c" > /dev/null
+$CC -O2 -o "$WORK/prime" "$WORK/prime.c" 2> /dev/null
+expected=$(echo 248050 | "$WORK/kxi" prime.kxi -run)
+check "-run prime.kxi 248050" "input:248041" "$(echo "$expected" | head -n 1)"
+check "-run jit prime.kxi 248050" "$expected" "$(echo 248050 | "$WORK/kxi" prime.kxi -run jit)"
+check "-emit-c prime.kxi 248050" "$expected" "$(echo 248050 | "$WORK/prime")"
+
+# freed blocks are reused: sort.kxi sorts 1560 characters in 64 KB at every -O level
+line=""
+i=0
+while [ $i -lt 60 ]; do
+    line="${line}zyxwvutsrqponmlkjihgfedcba"
+    i=$((i + 1))
+done
+sorted="input:"
+for letter in a b c d e f g h i j k l m n o p q r s t u v w x y z; do
+    i=0
+    while [ $i -lt 60 ]; do
+        sorted="$sorted$letter "
+        i=$((i + 1))
+    done
+done
+for level in "" "-O1" "-O2"; do
+    check "-run -mem 65536${level:+ $level} sort.kxi 1560 characters" "$sorted" "$(echo "$line" | "$WORK/kxi" sort.kxi -run -mem 65536 $level)"
+done
+
+# deleting a block twice is a VM error, not a corrupted free list
+printf 'class Node {\n\tpublic Node next;\n}\n\nvoid kxi2019 main() {\n\tNode n = new Node();\n\tdelete n;\n\tdelete n;\n\tcout << 1;\n}\n' > "$WORK/free.kxi"
+for mode in switch threaded jit; do
+    check "-run $mode double delete" "Heap Free Error!" "$("$WORK/kxi" "$WORK/free.kxi" -run $mode)"
+done
+
+exit $failed
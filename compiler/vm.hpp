@@ -16,11 +16,36 @@
 #include <vector>
 #include <map>
 #include <iterator>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include "jit.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define VM_MMAP_IMAGE
+#define VM_MMAP_MEMORY
+#define VM_GUARD_PAGES
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <setjmp.h>
+#endif
 
 #define REG_SIZE 13  // total general regesters
-#define MEM_SIZE 1000000  // total bytes of memory
+#define MEM_SIZE 1000000  // default bytes of memory, VM(memorySize) picks another size
+#define MEM_MIN_SIZE 1024
+#define MEM_MAX_SIZE (1 << 30)
+#define GUARD_SIZE 65536  // bytes of the guard pages above the heap top, see setGuard
+#define HEAP_SMALL_CLASSES 16  // heap size classes of 8, 16, ... 128 bytes, powers of two above, see allocate
+#define HEAP_CLASS_COUNT 21  // the last class holds HEAP_LARGE_SIZE bytes
+#define HEAP_LARGE_SIZE 4096  // larger blocks have their exact size, rounded up to 8 bytes
 #define FIX_LENGTH 12  // fixed length of an instrution
 #define INT_SIZE 4  // size of an integer
+#define IMAGE_MAGIC "KXIB"  // first bytes of an assembled program image
+#define IMAGE_VERSION 1
+#define PROFILE_REPORT_SIZE 12  // sequences of each length listed by D_Profile
 #define JMP 1
 #define JMR 2
 #define BNZ 3
@@ -46,29 +71,171 @@
 #define LDRI 23
 #define STBI 24
 #define LDBI 25
+#define STRO 26  // base + displacement forms, Oprand1 packs the data and base registers, see packRegisters
+#define LDRO 27
+#define STBO 28
+#define LDBO 29
+#define BLTR 30  // fused CMP and branch: BLT Rx, Ry, label jumps if Rx - Ry < 0, Oprand1 packs Rx and Ry
+#define BGTR 31
+#define BEQR 32
+#define BNER 33
+#define BLER 34
+#define BGER 35
+#define PUSH 36  // stack and call instructions, SP points at the next free slot and grows down
+#define POP 37
+#define FRAME 38  // FRAME Rthis, size, label: Oprand1 packs Rthis and the frame size, jumps to label on overflow
+#define CALL 39  // CALL label, size: the new FP is SP + size, the return address is saved at it
+#define RET 40  // RET label / RET Rx, label: jumps to label on underflow
+#define RETV 41  // decoded only: RET with a return value
+#define FRAMEG 42  // decoded only: FRAME in guard mode, the guard pages catch the overflow
+#define ERR_MEMORY 97  // decoded only: a checked memory access outside MEM, see memoryFault
+#define ERR_OPRAND 98  // decoded only: operand out of range
+#define ERR_OPCODE 99  // decoded only: no valid instruction at this address
 #define NOP 100
+#define SUPER_FIRST 101  // superinstructions, see superInstructionTable
+#define STRO_LDRO_LDRO 101
+#define LDRO_LDR_CMP 102
+#define LDR_MUL_ADD 103
+#define STRO_LDRO 104
+#define LDRO_LDRO 105
+#define LDRO_LDR 106
+#define MOV_LDRO 107
+#define MOV_MOV 108
+#define LDR_CMP 109
+#define ADD_STRO 110
+#define MUL_MOV 111
+#define LDR_ADD 112
+#define LDRO_FRAME 113
 #define _INT -4
 #define _BYT -1
 
+// labels-as-values are a GCC/Clang extension, other compilers use call threading
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_COMPUTED_GOTO
+#endif
+
+enum DispatchMode {
+    D_Switch,  // one switch on the opcode per instruction
+    D_Threaded,  // every decoded instruction jumps straight to the next one's handler
+    D_JIT,  // translate the decoded program to x86-64 code, falls back to D_Threaded elsewhere
+    D_Profile  // D_Switch one instruction at a time, then report the opcode sequences that ran most
+};
+
 struct Instruction {
     int OpCode;
     int Oprand1;
     int Oprand2;
 };
 
+struct DecodedOp;
+class VM;
+typedef DecodedOp * (*OpHandler)(VM & vm, DecodedOp * ip);
+
+// an instruction decoded once at load time, with its operands validated and resolved
+struct DecodedOp {
+    int OpCode;
+    int Value;  // immediate (ADI, LDA), displacement (STRO, LDRO, STBO, LDBO), Ry index (fused branches), frame size (FRAME, CALL) or trap number (TRP)
+    int * Reg1;  // first register operand
+    union {
+        int * Reg2;  // second register operand, the base register of STRO, LDRO, STBO, LDBO
+        char * Mem;  // absolute memory operand (LDR, STR, LDB, STB)
+        DecodedOp * Target;  // branch target (JMP, BNZ, BGT, BLT, BRZ, the fused branches, CALL), overflow/underflow handler (FRAME, RET)
+    };
+    int Addr;  // address of the instruction in MEM
+#ifdef VM_COMPUTED_GOTO
+    const void * Handler;  // label of this instruction's handler in runThreaded()
+#else
+    OpHandler Handler;  // this instruction's handler in runThreaded()
+#endif
+};
+
+// a run of instructions executed by one dispatch of OpCode, see VM::fuseSuperInstructions
+struct SuperInstruction {
+    int OpCode;
+    int Length;
+    int Sequence[3];  // opcodes of the run, all but the last one fall through
+};
+
+// header of an assembled program image, followed by the instruction addresses,
+// the MEM image and then the symbol table (address, name length, name) if any
+struct ImageHeader {
+    char Magic[4];
+    int Version;
+    int EntryPoint;  // address the JMP at MEM[0] jumps to
+    int MemoryUsedCount;
+    int InstructionCount;
+    int SymbolCount;
+};
+
 class VM {
 private:
     // VM register, 0 - 7: general Rigsiter, 8: PC, 9: SL, 10: SP, 11: FP, 12: SB
     int REG[REG_SIZE];  // VM registers
-    char MEM[MEM_SIZE];  // VM memory
+    char * MEM;  // VM memory, see allocateMemory
+    int memSize;  // bytes of MEM, SB starts at the last slot
     int memoryUsedCount;
     std::map<std::string, int> OpCodeTable;  // Operator Codes map (including Directives
     std::map<std::string, int> SymbolTable;  // Operator Codes map (including Directives
+    std::vector<int> instructionAddrs;  // addresses of all loaded instructions, in order
+    std::vector<DecodedOp> program;  // decoded instructions, last one is an ERR_OPCODE sentinel
+    std::vector<DecodedOp *> codeIndex;  // address -> decoded instruction, for JMR
+    DispatchMode dispatchMode;
+    unsigned char * jitCode;  // executable copy of the translated program, nullptr until compiled
+    int jitCodeSize;
+    std::vector<const void *> jitTable;  // address -> native code, for JMR
+    bool memoryChecks;  // bound-check the stack and FP relative accesses too, off for trusted programs
+    DecodedOp faultOp;  // where a failed memory check continues, see memoryFault
+    bool guardPages;  // guard mode, see setGuard
+    bool guardArmed;  // guard mode: the guard pages are protected while the program runs
+    int guardStart;  // guard mode: the first page boundary at or above SL, the guard pages start here
+    int pageSize;  // guard mode: the host's page size
+    DecodedOp * overflowOp;  // guard mode: the program's OVERFLOW handler
+    int heapBase;  // SL when the program started, the allocator's blocks lie between it and SL
+    std::vector<int> freeList;  // size class -> address of the first free block, 0 if none, the last list holds the large blocks
+    long long dispatchCount;  // D_Profile: instructions run
+    std::vector<long long> pairCount;  // D_Profile: times program[i] ran straight on into program[i + 1]
+    std::vector<long long> tripleCount;  // D_Profile: times program[i] ran straight on into program[i + 2]
+    
+    // size bytes of zeroed memory. The whole range is reserved at once but anonymous pages
+    // are only backed once they are touched, so an unused heap or stack costs nothing.
+    static char * allocateMemory(int size) {
+#ifdef VM_MMAP_MEMORY
+        void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return memory == MAP_FAILED ? nullptr : static_cast<char *>(memory);
+#else
+        return new (std::nothrow) char[size]();
+#endif
+    }
+    
+    void releaseMemory() {
+        if (MEM == nullptr) return;
+#ifdef VM_MMAP_MEMORY
+        munmap(MEM, memSize);
+#else
+        delete [] MEM;
+#endif
+        MEM = nullptr;
+    }
     
 public:
-    VM() {
+    // memorySize must be within MEM_MIN_SIZE and MEM_MAX_SIZE
+    VM(int memorySize = MEM_SIZE) {
+        memSize = memorySize;
+        MEM = allocateMemory(memSize);
         REG[8] = 0;
         memoryUsedCount = 0;
+        dispatchMode = D_Switch;
+        jitCode = nullptr;
+        jitCodeSize = 0;
+        memoryChecks = true;
+        faultOp = { ERR_MEMORY, 0, nullptr, { nullptr }, 0, nullptr };
+        guardPages = false;
+        guardArmed = false;
+        guardStart = 0;
+        pageSize = 0;
+        overflowOp = nullptr;
+        heapBase = 0;
+        dispatchCount = 0;
         
         OpCodeTable.insert(std::pair<std::string, int>("JMP", JMP));
         OpCodeTable.insert(std::pair<std::string, int>("JMR", JMR));
@@ -91,12 +258,36 @@ public:
         OpCodeTable.insert(std::pair<std::string, int>("OR", OR));
         OpCodeTable.insert(std::pair<std::string, int>("CMP", CMP));
         OpCodeTable.insert(std::pair<std::string, int>("TRP", TRP));
+        OpCodeTable.insert(std::pair<std::string, int>("STRO", STRO));
+        OpCodeTable.insert(std::pair<std::string, int>("LDRO", LDRO));
+        OpCodeTable.insert(std::pair<std::string, int>("STBO", STBO));
+        OpCodeTable.insert(std::pair<std::string, int>("LDBO", LDBO));
+        OpCodeTable.insert(std::pair<std::string, int>("BEQ", BEQR));
+        OpCodeTable.insert(std::pair<std::string, int>("BNE", BNER));
+        OpCodeTable.insert(std::pair<std::string, int>("BLE", BLER));
+        OpCodeTable.insert(std::pair<std::string, int>("BGE", BGER));
+        OpCodeTable.insert(std::pair<std::string, int>("PUSH", PUSH));
+        OpCodeTable.insert(std::pair<std::string, int>("POP", POP));
+        OpCodeTable.insert(std::pair<std::string, int>("FRAME", FRAME));
+        OpCodeTable.insert(std::pair<std::string, int>("CALL", CALL));
+        OpCodeTable.insert(std::pair<std::string, int>("RET", RET));
         OpCodeTable.insert(std::pair<std::string, int>("NOP", NOP));
         OpCodeTable.insert(std::pair<std::string, int>(".INT", _INT));
         OpCodeTable.insert(std::pair<std::string, int>(".BYT", _BYT));
     }
     
+    ~VM() {
+        releaseJIT();
+        releaseMemory();
+    }
+    
     void loadInstruction(int addr, int opcode, int oprand1, int oprand2) {
+        if (instructionAddrs.empty() || instructionAddrs.back() < addr) {
+            instructionAddrs.push_back(addr);
+        }
+        else if (addr == 0 && instructionAddrs.front() != 0) {
+            instructionAddrs.insert(instructionAddrs.begin(), 0);
+        }
         Instruction * ip = reinterpret_cast<Instruction *>(& MEM[addr]);
         ip->OpCode = opcode;
         ip->Oprand1 = oprand1;
@@ -104,7 +295,7 @@ public:
     }
     
     Instruction * fetchInstruction(int addr) {
-        if (addr + FIX_LENGTH > MEM_SIZE) {
+        if (addr + FIX_LENGTH > memSize) {
             return nullptr;
         }
         return reinterpret_cast<Instruction *>(& MEM[addr]);
@@ -164,647 +355,3090 @@ public:
         return 0;
     }
     
-    bool assemblyPass1(std::string fileName) {
+    // STRO/LDRO/STBO/LDBO carry two registers in Oprand1: the data register in the
+    // low byte and the base register above it, Oprand2 is the signed displacement
+    int packRegisters(int reg, int base) {
+        return reg | (base << 8);
+    }
+    
+    // Rx - Ry as CMP computes it, the fused branches test its sign like CMP + BLT/BGT/BRZ/BNZ
+    static int difference(int x, int y) {
+        return static_cast<int>(static_cast<unsigned int>(x) - static_cast<unsigned int>(y));
+    }
+    
+    // a label or number followed by another operand still carries its comma
+    static std::string withoutComma(const std::string & token) {
+        return token.size() > 1 && token.back() == ',' ? token.substr(0, token.size() - 1) : token;
+    }
+    
+    // split each line of an assembly file into tokens, comment lines become empty
+    bool readAssemblyFile(std::string fileName, std::vector<std::vector<std::string>> & lines) {
         std::ifstream inputFile(fileName);
-        if (inputFile) {
-            std::string line;
-            int lineCounter = 0;
-            int addrCounter = FIX_LENGTH;  //reserve first 12 bytes for start JMP
-            int tokenCounter = 0;
-            // check the input assembly file by Pass 1
-            //ignore all the whitespace
-            while (std::getline(inputFile, line)) {
-                lineCounter++;
-                unsigned long firstCharPos = line.find_first_not_of(" \t\n\r\v\f");
-                // skip empty lines and comments (start with ';')
-                if (firstCharPos != std::string::npos && line.at(firstCharPos) != ';') {
-                    // split a line into tokens
-                    std::istringstream iss(line);
-                    std::vector<std::string> tokens((std::istream_iterator<std::string>(iss)),std::istream_iterator<std::string>());
-                    if (tokens.size() < 1) {
+        if (!inputFile) {
+            std::cout << "Cannot open the file: " << fileName << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(inputFile, line)) {
+            unsigned long firstCharPos = line.find_first_not_of(" \t\n\r\v\f");
+            if (firstCharPos != std::string::npos && line.at(firstCharPos) != ';') {
+                std::istringstream iss(line);
+                lines.push_back(std::vector<std::string>((std::istream_iterator<std::string>(iss)),std::istream_iterator<std::string>()));
+            } else {
+                lines.push_back(std::vector<std::string>());
+            }
+        }
+        return true;
+    }
+    
+    // assemble a whole program held in memory, e.g. handed over from the compiler
+    bool assemble(const std::vector<std::vector<std::string>> & lines) {
+        return assemblyPass1(lines) && assemblyPass2(lines);
+    }
+    
+    // assemble a file, reading it only once for both passes
+    bool assemble(std::string fileName) {
+        std::vector<std::vector<std::string>> lines;
+        if (!readAssemblyFile(fileName, lines)) return false;
+        return assemble(lines);
+    }
+    
+    bool assemblyPass1(std::string fileName) {
+        std::vector<std::vector<std::string>> lines;
+        if (!readAssemblyFile(fileName, lines)) return false;
+        return assemblyPass1(lines);
+    }
+    
+    // lines are already split into tokens, an empty line is skipped like a comment
+    bool assemblyPass1(const std::vector<std::vector<std::string>> & lines) {
+        int addrCounter = FIX_LENGTH;  //reserve first 12 bytes for start JMP
+        size_t tokenCounter = 0;
+        if (MEM == nullptr) {
+            std::cout << "Memory Allocation Error!\n";
+            return false;
+        }
+        // check the input assembly file by Pass 1
+        //ignore all the whitespace
+        for (int lineCounter = 1; lineCounter <= static_cast<int>(lines.size()); lineCounter++) {
+            const std::vector<std::string> & tokens = lines[lineCounter - 1];
+            if (tokens.size() > 0) {
+                if (tokens.size() < 2) {
+                    if (OpCodeTable.find(tokens[0]) == OpCodeTable.end()) {
+                        if (SymbolTable.find(tokens[0]) != SymbolTable.end()) {
+                            std::cout << "Repeated Label. (line: " << lineCounter << ")\n";
+                            return false;
+                        }
+                        // treat a single label as a NOP command
+                        SymbolTable.insert(std::pair<std::string, int>(tokens[0], addrCounter));
+                        addrCounter += FIX_LENGTH;
+                    } else {
                         std::cout << "Command line too short. (line: " << lineCounter << ")\n";
                         return false;
                     }
-                    if (tokens.size() < 2) {
-                        if (OpCodeTable.find(tokens[0]) == OpCodeTable.end()) {
-                            if (SymbolTable.find(tokens[0]) != SymbolTable.end()) {
-                                std::cout << "Repeated Label. (line: " << lineCounter << ")\n";
-                                return false;
-                            }
-                            // treat a single label as a NOP command
-                            SymbolTable.insert(std::pair<std::string, int>(tokens[0], addrCounter));
-                            addrCounter += FIX_LENGTH;
-                        } else {
-                            std::cout << "Command line too short. (line: " << lineCounter << ")\n";
+                } else {
+                    tokenCounter = 0;
+                    if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
+                        // if first token is a Label, check if it is a new one, if yes, put it in the Symbol table
+                        if (SymbolTable.find(tokens[tokenCounter]) != SymbolTable.end()) {
+                            std::cout << "Repeated Label. (line: " << lineCounter << ")\n";
                             return false;
                         }
-                    } else {
-                        tokenCounter = 0;
+                        SymbolTable.insert(std::pair<std::string, int>(tokens[tokenCounter], addrCounter));
+                        tokenCounter++;
                         if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
-                            // if first token is a Label, check if it is a new one, if yes, put it in the Symbol table
-                            if (SymbolTable.find(tokens[tokenCounter]) != SymbolTable.end()) {
-                                std::cout << "Repeated Label. (line: " << lineCounter << ")\n";
-                                return false;
-                            }
-                            SymbolTable.insert(std::pair<std::string, int>(tokens[tokenCounter], addrCounter));
-                            tokenCounter++;
-                            if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
-                                std::cout << "Error format command line. (line: " << lineCounter << ")\n";
-                                return false;
-                            }
-                        } // after this checking, we found a OpCode, and the tokenCounter is pointing to the OpCode
-                        if (OpCodeTable[tokens[tokenCounter]] > 0) {
-                            // it is an Instruction
-                            addrCounter += FIX_LENGTH;
-                        } else {
-                            // it is a directive
-                            addrCounter += -OpCodeTable[tokens[tokenCounter]];
+                            std::cout << "Error format command line. (line: " << lineCounter << ")\n";
+                            return false;
                         }
+                    } // after this checking, we found a OpCode, and the tokenCounter is pointing to the OpCode
+                    if (OpCodeTable[tokens[tokenCounter]] > 0) {
+                        // it is an Instruction
+                        addrCounter += FIX_LENGTH;
+                    } else {
+                        // it is a directive
+                        addrCounter += -OpCodeTable[tokens[tokenCounter]];
                     }
                 }
             }
-            // pass first checking step
-            return true;
-        } else {
-            std::cout << "Cannot open the file: " << fileName << std::endl;
+        }
+        // pass first checking step
+        if (addrCounter > memSize - INT_SIZE) {
+            std::cout << "Program too large for " << memSize << " bytes of memory.\n";
             return false;
         }
+        return true;
     }
     
     bool assemblyPass2(std::string fileName) {
-        std::ifstream inputFile(fileName);
-        if (inputFile) {
-            std::string line;
-            int lineCounter = 0;
-            int addrCounter = FIX_LENGTH;   //reserve first 12 bytes for start JMP
-            int tokenCounter = 0;
-            bool programStart = false;
-            // check the input assembly file by Pass 2, if commands are correct, load them to Memory
-            //ignore all the whitespace
-            while (std::getline(inputFile, line)) {
-                lineCounter++;
-                unsigned long firstCharPos = line.find_first_not_of(" \t\n\r\v\f");
-                // skip empty lines and comments (start with ';')
-                if (firstCharPos != std::string::npos && line.at(firstCharPos) != ';') {
-                    // split a line into tokens
-                    std::istringstream iss(line);
-                    std::vector<std::string> tokens((std::istream_iterator<std::string>(iss)),std::istream_iterator<std::string>());
-                    if (tokens.size() < 1) {
+        std::vector<std::vector<std::string>> lines;
+        if (!readAssemblyFile(fileName, lines)) return false;
+        return assemblyPass2(lines);
+    }
+    
+    // lines are already split into tokens, an empty line is skipped like a comment
+    bool assemblyPass2(const std::vector<std::vector<std::string>> & lines) {
+        int addrCounter = FIX_LENGTH;   //reserve first 12 bytes for start JMP
+        size_t tokenCounter = 0;
+        bool programStart = false;
+        instructionAddrs.clear();
+        // check the input assembly file by Pass 2, if commands are correct, load them to Memory
+        //ignore all the whitespace
+        for (int lineCounter = 1; lineCounter <= static_cast<int>(lines.size()); lineCounter++) {
+            const std::vector<std::string> & tokens = lines[lineCounter - 1];
+            if (tokens.size() > 0) {
+                if (tokens.size() < 2) {
+                    if (OpCodeTable.find(tokens[0]) == OpCodeTable.end()) {
+                        if (SymbolTable.find(tokens[0]) == SymbolTable.end()) {
+                            std::cout << "Unexpected error  . (line: " << lineCounter << ")\n";
+                            return false;
+                        }
+                        // treat a single label as a NOP command
+                        loadInstruction(addrCounter, NOP, 0, 0);
+                        addrCounter += FIX_LENGTH;
+                    } else {
                         std::cout << "Command line too short. (line: " << lineCounter << ")\n";
                         return false;
                     }
-                    if (tokens.size() < 2) {
-                        if (OpCodeTable.find(tokens[0]) == OpCodeTable.end()) {
-                            if (SymbolTable.find(tokens[0]) == SymbolTable.end()) {
-                                std::cout << "Unexpected error  . (line: " << lineCounter << ")\n";
-                                return false;
-                            }
-                            // treat a single label as a NOP command
-                            loadInstruction(addrCounter, NOP, 0, 0);
-                            addrCounter += FIX_LENGTH;
-                        } else {
-                            std::cout << "Command line too short. (line: " << lineCounter << ")\n";
+                } else {
+                    tokenCounter = 0;
+                    if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
+                        tokenCounter++;
+                        if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
+                            std::cout << "Error format command line. (line: " << lineCounter << ")\n";
                             return false;
                         }
-                    } else {
-                        tokenCounter = 0;
-                        if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
-                            tokenCounter++;
-                            if (OpCodeTable.find(tokens[tokenCounter]) == OpCodeTable.end()) {
-                                std::cout << "Error format command line. (line: " << lineCounter << ")\n";
-                                return false;
-                            }
-                        } // after this checking, we found a OpCode, and the tokenCounter is pointing to the OpCode
-                        if (OpCodeTable[tokens[tokenCounter]] > 0) {
-                            // it is an Instruction
-                            if (!programStart) {
-                                setProgramStartPoint(addrCounter);
-                                programStart = true;
-                            }
-                            switch (OpCodeTable[tokens[tokenCounter]]) {
-                                case JMP:
-                                    if (tokenCounter + 1 < tokens.size() && SymbolTable.find(tokens[tokenCounter + 1]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, JMP, SymbolTable[tokens[tokenCounter + 1]], 0);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case JMR:
-                                    if (tokenCounter + 1 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
-                                        loadInstruction(addrCounter, JMR, getRegisterId(tokens[tokenCounter + 1]), 0);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case BNZ:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, BNZ, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case BGT:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, BGT, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case BLT:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, BLT, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case BRZ:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, BRZ, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case MOV:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && (tokens[tokenCounter + 2] == "PC" || isRegsterName(tokens[tokenCounter + 2]))) {
-                                        loadInstruction(addrCounter, MOV, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case LDA:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                        loadInstruction(addrCounter, LDA, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case STR:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
-                                        if (isRegsterName(tokens[tokenCounter + 2])) {
-                                            loadInstruction(addrCounter, STRI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                        } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                            loadInstruction(addrCounter, STR, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                        } else {
-                                            std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
-                                            return false;
-                                        }
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case LDR:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
-                                        if (isRegsterName(tokens[tokenCounter + 2])) {
-                                            loadInstruction(addrCounter, LDRI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                        } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                            loadInstruction(addrCounter, LDR, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                        } else {
-                                            std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
-                                            return false;
-                                        }
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case STB:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
-                                        if (isRegsterName(tokens[tokenCounter + 2])) {
-                                            loadInstruction(addrCounter, STBI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                        } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                            loadInstruction(addrCounter, STB, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                        } else {
-                                            std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
-                                            return false;
-                                        }
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case LDB:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
-                                        if (isRegsterName(tokens[tokenCounter + 2])) {
-                                            loadInstruction(addrCounter, LDBI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                        } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
-                                            loadInstruction(addrCounter, LDB, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
-                                        } else {
-                                            std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
-                                            return false;
-                                        }
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case ADD:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, ADD, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case ADI:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isNumber(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, ADI, getRegisterId(tokens[tokenCounter + 1]), std::stoi(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case SUB:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, SUB, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case MUL:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, MUL, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case DIV:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, DIV, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
-                                    } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
-                                        return false;
-                                    }
-                                    break;
-                                case AND:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, AND, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                    } // after this checking, we found a OpCode, and the tokenCounter is pointing to the OpCode
+                    if (OpCodeTable[tokens[tokenCounter]] > 0) {
+                        // it is an Instruction
+                        if (!programStart) {
+                            setProgramStartPoint(addrCounter);
+                            programStart = true;
+                        }
+                        switch (OpCodeTable[tokens[tokenCounter]]) {
+                            case JMP:
+                                if (tokenCounter + 1 < tokens.size() && SymbolTable.find(tokens[tokenCounter + 1]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, JMP, SymbolTable[tokens[tokenCounter + 1]], 0);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case JMR:
+                                if (tokenCounter + 1 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    loadInstruction(addrCounter, JMR, getRegisterId(tokens[tokenCounter + 1]), 0);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case BNZ:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, BNZ, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case BGT:
+                                if (tokenCounter + 3 < tokens.size()) {
+                                    // BLT/BGT Rx, Ry, label is the fused form
+                                    if (!assembleFusedBranch(tokens, tokenCounter, BGTR, addrCounter, lineCounter)) return false;
+                                } else if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, BGT, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case BLT:
+                                if (tokenCounter + 3 < tokens.size()) {
+                                    // BLT/BGT Rx, Ry, label is the fused form
+                                    if (!assembleFusedBranch(tokens, tokenCounter, BLTR, addrCounter, lineCounter)) return false;
+                                } else if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, BLT, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case BRZ:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, BRZ, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case MOV:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && (tokens[tokenCounter + 2] == "PC" || isRegsterName(tokens[tokenCounter + 2]))) {
+                                    loadInstruction(addrCounter, MOV, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case LDA:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, LDA, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case STR:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    if (isRegsterName(tokens[tokenCounter + 2])) {
+                                        loadInstruction(addrCounter, STRI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                    } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                        loadInstruction(addrCounter, STR, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
                                     } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                        std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
                                         return false;
                                     }
-                                    break;
-                                case OR:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, OR, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case LDR:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    if (isRegsterName(tokens[tokenCounter + 2])) {
+                                        loadInstruction(addrCounter, LDRI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                    } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                        loadInstruction(addrCounter, LDR, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
                                     } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                        std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
                                         return false;
                                     }
-                                    break;
-                                case CMP:
-                                    if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
-                                        loadInstruction(addrCounter, CMP, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case STB:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    if (isRegsterName(tokens[tokenCounter + 2])) {
+                                        loadInstruction(addrCounter, STBI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                    } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                        loadInstruction(addrCounter, STB, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
                                     } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                        std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
                                         return false;
                                     }
-                                    break;
-                                case TRP:
-                                    if (tokenCounter + 1 < tokens.size() && tokens[tokenCounter + 1].size() == 1 && tokens[tokenCounter + 1].at(0) <= '4' && tokens[tokenCounter + 1].at(0) >= '0') {
-                                        loadInstruction(addrCounter, TRP, tokens[tokenCounter + 1].at(0) - '0', 0);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case LDB:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    if (isRegsterName(tokens[tokenCounter + 2])) {
+                                        loadInstruction(addrCounter, LDBI, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                    } else if (SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                        loadInstruction(addrCounter, LDB, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
                                     } else {
-                                        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                        std::cout << "Command Line Error1. (line: " << lineCounter << ")\n";
                                         return false;
                                     }
-                                    break;
-                                case NOP:
-                                    loadInstruction(addrCounter, NOP, 0, 0);
-                                    break;
-                            }
-                            addrCounter += FIX_LENGTH;
-                        } else {
-                            // it is a directive
-                            if (tokenCounter + 1 < tokens.size()) {
-                                if (OpCodeTable[tokens[tokenCounter]] == _BYT) {  // handle character format like 'c'
-                                    if (tokens[tokenCounter + 1].size() == 3 && tokens[tokenCounter + 1].at(0) == '\'' && tokens[tokenCounter + 1].at(2) == '\'') {
-                                        setByte(addrCounter, tokens[tokenCounter + 1].at(1));
-                                    } else { // handle number format like 10
-                                        if (tokens[tokenCounter + 1].find_first_not_of("0123456789") == std::string::npos) {
-                                            setByte(addrCounter, static_cast<char>(std::stoi(tokens[tokenCounter + 1])));
-                                        } else {
-                                            std::cout << ".BYT data Format Error. (line: " << lineCounter << ")\n";
-                                            return false;
-                                        }
-                                    }
-                                } else {  // directive of .INT
-                                    if (isNumber(tokens[tokenCounter + 1])) {
-                                        setInt(addrCounter, std::stoi(tokens[tokenCounter + 1]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case ADD:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, ADD, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case ADI:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isNumber(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, ADI, getRegisterId(tokens[tokenCounter + 1]), std::stoi(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case SUB:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, SUB, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case MUL:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, MUL, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case DIV:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, DIV, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case AND:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, AND, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case OR:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, OR, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case CMP:
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, CMP, getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case TRP:
+                                if (tokenCounter + 1 < tokens.size() && tokens[tokenCounter + 1].size() == 1 && tokens[tokenCounter + 1].at(0) <= '6' && tokens[tokenCounter + 1].at(0) >= '0') {
+                                    loadInstruction(addrCounter, TRP, tokens[tokenCounter + 1].at(0) - '0', 0);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case BEQR:
+                            case BNER:
+                            case BLER:
+                            case BGER:
+                                if (!assembleFusedBranch(tokens, tokenCounter, OpCodeTable[tokens[tokenCounter]], addrCounter, lineCounter)) return false;
+                                break;
+                            case PUSH:
+                            case POP:
+                                if (tokenCounter + 1 < tokens.size() && isRegsterName(tokens[tokenCounter + 1])) {
+                                    loadInstruction(addrCounter, OpCodeTable[tokens[tokenCounter]], getRegisterId(tokens[tokenCounter + 1]), 0);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case FRAME:
+                                // FRAME Rthis, size, overflow label
+                                if (tokenCounter + 3 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isNumber(withoutComma(tokens[tokenCounter + 2])) && SymbolTable.find(tokens[tokenCounter + 3]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, FRAME, getRegisterId(tokens[tokenCounter + 1]) | (std::stoi(withoutComma(tokens[tokenCounter + 2])) << 8), SymbolTable[tokens[tokenCounter + 3]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case CALL:
+                                // CALL label, size
+                                if (tokenCounter + 2 < tokens.size() && SymbolTable.find(withoutComma(tokens[tokenCounter + 1])) != SymbolTable.end() && isNumber(tokens[tokenCounter + 2])) {
+                                    loadInstruction(addrCounter, CALL, SymbolTable[withoutComma(tokens[tokenCounter + 1])], std::stoi(tokens[tokenCounter + 2]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case RET:
+                                // RET underflow label, or RET Rx, underflow label to return Rx
+                                if (tokenCounter + 2 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && SymbolTable.find(tokens[tokenCounter + 2]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, RETV, getRegisterId(tokens[tokenCounter + 1]), SymbolTable[tokens[tokenCounter + 2]]);
+                                } else if (tokenCounter + 1 < tokens.size() && SymbolTable.find(tokens[tokenCounter + 1]) != SymbolTable.end()) {
+                                    loadInstruction(addrCounter, RET, 0, SymbolTable[tokens[tokenCounter + 1]]);
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case STRO:
+                            case LDRO:
+                            case STBO:
+                            case LDBO:
+                                // OP Rd, Rbase, displacement
+                                if (tokenCounter + 3 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2]) && isNumber(tokens[tokenCounter + 3])) {
+                                    loadInstruction(addrCounter, OpCodeTable[tokens[tokenCounter]], packRegisters(getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2])), std::stoi(tokens[tokenCounter + 3]));
+                                } else {
+                                    std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
+                                break;
+                            case NOP:
+                                loadInstruction(addrCounter, NOP, 0, 0);
+                                break;
+                        }
+                        addrCounter += FIX_LENGTH;
+                    } else {
+                        // it is a directive
+                        if (tokenCounter + 1 < tokens.size()) {
+                            if (OpCodeTable[tokens[tokenCounter]] == _BYT) {  // handle character format like 'c'
+                                if (tokens[tokenCounter + 1].size() == 3 && tokens[tokenCounter + 1].at(0) == '\'' && tokens[tokenCounter + 1].at(2) == '\'') {
+                                    setByte(addrCounter, tokens[tokenCounter + 1].at(1));
+                                } else { // handle number format like 10
+                                    if (tokens[tokenCounter + 1].find_first_not_of("0123456789") == std::string::npos) {
+                                        setByte(addrCounter, static_cast<char>(std::stoi(tokens[tokenCounter + 1])));
                                     } else {
-                                        std::cout << ".INT data Format Error. (line: " << lineCounter << ")\n";
+                                        std::cout << ".BYT data Format Error. (line: " << lineCounter << ")\n";
                                         return false;
                                     }
                                 }
-                            } else {
-                                std::cout << "Command Line too short. (line: " << lineCounter << ")\n";
-                                return false;
+                            } else {  // directive of .INT
+                                if (isNumber(tokens[tokenCounter + 1])) {
+                                    setInt(addrCounter, std::stoi(tokens[tokenCounter + 1]));
+                                } else {
+                                    std::cout << ".INT data Format Error. (line: " << lineCounter << ")\n";
+                                    return false;
+                                }
                             }
-                            addrCounter += -OpCodeTable[tokens[tokenCounter]];
+                        } else {
+                            std::cout << "Command Line too short. (line: " << lineCounter << ")\n";
+                            return false;
                         }
+                        addrCounter += -OpCodeTable[tokens[tokenCounter]];
                     }
                 }
             }
-            // pass second checking step
-            memoryUsedCount = addrCounter; // store total bytes used by all codes and data
+        }
+        // pass second checking step
+        memoryUsedCount = addrCounter; // store total bytes used by all codes and data
+        decodeProgram();
+        return true;
+    }
+    
+    // OP Rx, Ry, label for the fused compare and branch opcodes
+    bool assembleFusedBranch(const std::vector<std::string> & tokens, size_t tokenCounter, int opcode, int addrCounter, int lineCounter) {
+        if (tokenCounter + 3 < tokens.size() && isRegsterName(tokens[tokenCounter + 1]) && isRegsterName(tokens[tokenCounter + 2]) && SymbolTable.find(tokens[tokenCounter + 3]) != SymbolTable.end()) {
+            loadInstruction(addrCounter, opcode, packRegisters(getRegisterId(tokens[tokenCounter + 1]), getRegisterId(tokens[tokenCounter + 2])), SymbolTable[tokens[tokenCounter + 3]]);
             return true;
-        } else {
+        }
+        std::cout << "Command Line Error. (line: " << lineCounter << ")\n";
+        return false;
+    }
+    
+    // write the assembled program as a binary image, so it can be run without assembling it again
+    bool saveImage(std::string fileName, bool withSymbols) {
+        std::ofstream imageFile(fileName, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!imageFile.is_open()) {
             std::cout << "Cannot open the file: " << fileName << std::endl;
             return false;
         }
+        ImageHeader header;
+        std::memcpy(header.Magic, IMAGE_MAGIC, 4);
+        header.Version = IMAGE_VERSION;
+        header.EntryPoint = instructionAddrs.empty() ? 0 : fetchInstruction(0)->Oprand1;
+        header.MemoryUsedCount = memoryUsedCount;
+        header.InstructionCount = static_cast<int>(instructionAddrs.size());
+        header.SymbolCount = withSymbols ? static_cast<int>(SymbolTable.size()) : 0;
+        imageFile.write(reinterpret_cast<const char *>(& header), sizeof(header));
+        imageFile.write(reinterpret_cast<const char *>(instructionAddrs.data()), instructionAddrs.size() * sizeof(int));
+        imageFile.write(MEM, memoryUsedCount);
+        if (withSymbols) {
+            for (auto it = SymbolTable.begin(); it != SymbolTable.end(); it++) {
+                int nameLength = static_cast<int>(it->first.size());
+                imageFile.write(reinterpret_cast<const char *>(& it->second), sizeof(int));
+                imageFile.write(reinterpret_cast<const char *>(& nameLength), sizeof(int));
+                imageFile.write(it->first.data(), nameLength);
+            }
+        }
+        imageFile.close();
+        return true;
     }
     
-    void run() {
-        bool programStop = false;
-        REG[8] = 0; // setting the PC register, start from MEM[0]
-        REG[9] = memoryUsedCount; // setting the SL register next to the last used byte
-        REG[12] = MEM_SIZE - 4; // setting the SB register to the last slot of Memory
-        REG[10] = REG[12]; // setting the SP register
-        REG[11] = REG[10]; // setting the FP register, first pointing to out of memory
-        while (!programStop && REG[8] < MEM_SIZE) {
-            Instruction * ip = fetchInstruction(REG[8]);
-            if (ip == nullptr) {
-                std::cout << "Out of Memory!" << std::endl;
-                return;
+    // load a program image written by saveImage, in place of assemblyPass1 and assemblyPass2
+    bool loadImage(std::string fileName) {
+        std::vector<char> buffer;
+        const char * data = nullptr;
+        long size = 0;
+        if (MEM == nullptr) {
+            std::cout << "Memory Allocation Error!\n";
+            return false;
+        }
+#ifdef VM_MMAP_IMAGE
+        int fd = open(fileName.c_str(), O_RDONLY);
+        struct stat fileStat;
+        if (fd < 0 || fstat(fd, & fileStat) != 0) {
+            if (fd >= 0) close(fd);
+            std::cout << "Cannot open the file: " << fileName << std::endl;
+            return false;
+        }
+        size = fileStat.st_size;
+        void * mapped = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            std::cout << "Image Format Error. (" << fileName << ")\n";
+            return false;
+        }
+        data = static_cast<const char *>(mapped);
+#else
+        std::ifstream imageFile(fileName, std::ios::in | std::ios::binary);
+        if (!imageFile.is_open()) {
+            std::cout << "Cannot open the file: " << fileName << std::endl;
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(imageFile), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = static_cast<long>(buffer.size());
+#endif
+        bool loaded = loadImageData(data, size);
+#ifdef VM_MMAP_IMAGE
+        munmap(const_cast<char *>(data), size);
+#endif
+        if (!loaded) {
+            std::cout << "Image Format Error. (" << fileName << ")\n";
+        }
+        return loaded;
+    }
+    
+    bool loadImageData(const char * data, long size) {
+        ImageHeader header;
+        if (size < static_cast<long>(sizeof(header))) return false;
+        std::memcpy(& header, data, sizeof(header));
+        if (std::memcmp(header.Magic, IMAGE_MAGIC, 4) != 0 || header.Version != IMAGE_VERSION) return false;
+        if (header.MemoryUsedCount < 0 || header.MemoryUsedCount > memSize - INT_SIZE
+            || header.InstructionCount < 0 || header.InstructionCount > header.MemoryUsedCount / FIX_LENGTH
+            || header.SymbolCount < 0) return false;
+        long pos = sizeof(header);
+        long addrBytes = static_cast<long>(header.InstructionCount) * sizeof(int);
+        if (size < pos + addrBytes + header.MemoryUsedCount) return false;
+        instructionAddrs.resize(header.InstructionCount);
+        std::memcpy(instructionAddrs.data(), data + pos, addrBytes);
+        pos += addrBytes;
+        for (int i = 0; i < static_cast<int>(instructionAddrs.size()); i++) {
+            if (instructionAddrs[i] < 0 || instructionAddrs[i] + FIX_LENGTH > header.MemoryUsedCount
+                || (i > 0 && instructionAddrs[i] < instructionAddrs[i - 1] + FIX_LENGTH)) return false;
+        }
+        std::memcpy(MEM, data + pos, header.MemoryUsedCount);
+        pos += header.MemoryUsedCount;
+        memoryUsedCount = header.MemoryUsedCount;
+        // the image may come from anywhere: it must start with the JMP to its entry point
+        // and hold only opcodes the assembler writes
+        if (instructionAddrs.empty() || instructionAddrs[0] != 0 || fetchInstruction(0)->OpCode != JMP
+            || fetchInstruction(0)->Oprand1 != header.EntryPoint) return false;
+        for (int i = 0; i < static_cast<int>(instructionAddrs.size()); i++) {
+            if (!isAssembledOpCode(fetchInstruction(instructionAddrs[i])->OpCode)) return false;
+        }
+        SymbolTable.clear();
+        for (int i = 0; i < header.SymbolCount; i++) {
+            int addr, nameLength;
+            if (size < pos + 2 * static_cast<long>(sizeof(int))) return false;
+            std::memcpy(& addr, data + pos, sizeof(int));
+            std::memcpy(& nameLength, data + pos + sizeof(int), sizeof(int));
+            pos += 2 * sizeof(int);
+            if (nameLength < 0 || size < pos + nameLength) return false;
+            if (addr < 0 || addr > memoryUsedCount) return false;
+            SymbolTable.insert(std::pair<std::string, int>(std::string(data + pos, nameLength), addr));
+            pos += nameLength;
+        }
+        decodeProgram();
+        // register numbers and static addresses, as decodeProgram checked them
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            if (program[i].OpCode == ERR_OPRAND) return false;
+        }
+        return true;
+    }
+    
+    // opcodes assemblyPass2 loads into MEM, the decoded only ones excepted
+    static bool isAssembledOpCode(int opcode) {
+        return (opcode >= JMP && opcode <= RETV) || opcode == NOP;
+    }
+    
+    bool isValidRegister(int id) {
+        // PC can only be read by MOV, which is decoded to LDA
+        return id >= 0 && id < REG_SIZE && id != 8;
+    }
+    
+    // decode every loaded instruction once, so run() never re-reads or re-checks MEM
+    void decodeProgram() {
+        releaseJIT();
+        program.clear();
+        codeIndex.clear();
+        overflowOp = nullptr;
+        // lay out the decoded program in address order, with an ERR_OPCODE op
+        // wherever falling through would run into data instead of an instruction
+        for (int i = 0; i < static_cast<int>(instructionAddrs.size()); i++) {
+            if (i > 0 && instructionAddrs[i - 1] + FIX_LENGTH != instructionAddrs[i]) {
+                program.push_back({ ERR_OPCODE, 0, nullptr, { nullptr }, instructionAddrs[i - 1] + FIX_LENGTH, nullptr });
+            }
+            program.push_back({ NOP, 0, nullptr, { nullptr }, instructionAddrs[i], nullptr });
+        }
+        program.push_back({ ERR_OPCODE, 0, nullptr, { nullptr }, instructionAddrs.empty() ? 0 : instructionAddrs.back() + FIX_LENGTH, nullptr });
+        DecodedOp * sentinel = & program.back();
+        codeIndex.assign(memoryUsedCount + 1, sentinel);
+        for (int i = 0; i < static_cast<int>(program.size()) - 1; i++) {
+            if (program[i].OpCode != ERR_OPCODE) {
+                codeIndex[program[i].Addr] = & program[i];
             }
-            switch (ip -> OpCode) {
+        }
+        for (int i = 0; i < static_cast<int>(program.size()) - 1; i++) {
+            DecodedOp & op = program[i];
+            if (op.OpCode == ERR_OPCODE) continue;
+            Instruction * ip = fetchInstruction(op.Addr);
+            op.OpCode = ip->OpCode;
+            switch (ip->OpCode) {
                 case JMP:
-                    REG[8] = ip -> Oprand1;
+                    op.Target = findOp(ip->Oprand1);
                     break;
                 case JMR:
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE) {
-                        REG[8] = REG[ip->Oprand1];
+                    if (isValidRegister(ip->Oprand1)) {
+                        op.Reg1 = & REG[ip->Oprand1];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case BNZ:
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - FIX_LENGTH) {
-                        if (REG[ip->Oprand1] != 0) {
-                            REG[8] = ip->Oprand2;
-                        } else {
-                            REG[8] += FIX_LENGTH;
-                        }
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
-                    break;
                 case BGT:
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - FIX_LENGTH) {
-                        if (REG[ip->Oprand1] > 0) {
-                            REG[8] = ip->Oprand2;
-                        } else {
-                            REG[8] += FIX_LENGTH;
-                        }
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
-                    break;
                 case BLT:
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - FIX_LENGTH) {
-                        if (REG[ip->Oprand1] < 0) {
-                            REG[8] = ip->Oprand2;
-                        } else {
-                            REG[8] += FIX_LENGTH;
-                        }
+                case BRZ:
+                    if (isValidRegister(ip->Oprand1) && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - FIX_LENGTH) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Target = findOp(ip->Oprand2);
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case BRZ:
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - FIX_LENGTH) {
-                        if (REG[ip->Oprand1] == 0) {
-                            REG[8] = ip->Oprand2;
-                        } else {
-                            REG[8] += FIX_LENGTH;
-                        }
+                case BLTR:
+                case BGTR:
+                case BEQR:
+                case BNER:
+                case BLER:
+                case BGER:
+                    // Ry is kept as an index in Value, the union holds the target
+                    if (isValidRegister(ip->Oprand1 & 0xFF) && isValidRegister(ip->Oprand1 >> 8) && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - FIX_LENGTH) {
+                        op.Reg1 = & REG[ip->Oprand1 & 0xFF];
+                        op.Value = ip->Oprand1 >> 8;
+                        op.Target = findOp(ip->Oprand2);
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case MOV:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] = REG[ip->Oprand2];
+                    if (ip->Oprand2 == 8 && isValidRegister(ip->Oprand1)) {
+                        // PC has already moved past this instruction when it is read
+                        op.OpCode = LDA;
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Value = op.Addr + FIX_LENGTH;
+                    } else if (isValidRegister(ip->Oprand1) && isValidRegister(ip->Oprand2)) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Reg2 = & REG[ip->Oprand2];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case LDA:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - INT_SIZE) {
-                        REG[ip->Oprand1] = ip->Oprand2;
+                    if (isValidRegister(ip->Oprand1) && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - INT_SIZE) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Value = ip->Oprand2;
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case STR:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - INT_SIZE) {
-                        int *p = reinterpret_cast<int *>(&MEM[ip->Oprand2]);
-                        *p = REG[ip->Oprand1];
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
-                    break;
                 case LDR:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 <= MEM_SIZE - INT_SIZE) {
-                        int *p = reinterpret_cast<int *>(&MEM[ip->Oprand2]);
-                        REG[ip->Oprand1] = *p;
+                    if (isValidRegister(ip->Oprand1) && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - INT_SIZE) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Mem = & MEM[ip->Oprand2];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case STB:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 < MEM_SIZE) {
-                        MEM[ip->Oprand2] = static_cast<char>(REG[ip->Oprand1]);
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
-                    break;
                 case LDB:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 < MEM_SIZE) {
-                        REG[ip->Oprand1] = 0; // clear the register
-                        REG[ip->Oprand1] = static_cast<int>(MEM[ip->Oprand2]);
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
-                    break;
-                case ADD:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] += REG[ip->Oprand2];
+                    if (isValidRegister(ip->Oprand1) && ip->Oprand2 >= 0 && ip->Oprand2 < memSize) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Mem = & MEM[ip->Oprand2];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
                 case ADI:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE) {
-                        REG[ip->Oprand1] += ip->Oprand2;
+                    if (isValidRegister(ip->Oprand1)) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Value = ip->Oprand2;
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
+                case ADD:
                 case SUB:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] -= REG[ip->Oprand2];
+                case MUL:
+                case DIV:
+                case AND:
+                case OR:
+                case CMP:
+                case STRI:
+                case LDRI:
+                case STBI:
+                case LDBI:
+                    if (isValidRegister(ip->Oprand1) && isValidRegister(ip->Oprand2)) {
+                        op.Reg1 = & REG[ip->Oprand1];
+                        op.Reg2 = & REG[ip->Oprand2];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case MUL:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] *= REG[ip->Oprand2];
+                case STRO:
+                case LDRO:
+                case STBO:
+                case LDBO:
+                    if (isValidRegister(ip->Oprand1 & 0xFF) && isValidRegister(ip->Oprand1 >> 8)) {
+                        op.Reg1 = & REG[ip->Oprand1 & 0xFF];
+                        op.Reg2 = & REG[ip->Oprand1 >> 8];
+                        op.Value = ip->Oprand2;
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case DIV:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] /= REG[ip->Oprand2];
+                case PUSH:
+                case POP:
+                    if (isValidRegister(ip->Oprand1)) {
+                        op.Reg1 = & REG[ip->Oprand1];
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case AND:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        if (REG[ip->Oprand1] == 0 || REG[ip->Oprand2] == 0) {
-                            REG[ip->Oprand1] = 0;
-                        } else {
-                            REG[ip->Oprand1] = 1;
-                        }
+                case FRAME:
+                    if (isValidRegister(ip->Oprand1 & 0xFF) && ip->Oprand1 >= 0 && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - FIX_LENGTH) {
+                        op.Reg1 = & REG[ip->Oprand1 & 0xFF];
+                        op.Value = ip->Oprand1 >> 8;
+                        op.Target = findOp(ip->Oprand2);
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case OR:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        if (REG[ip->Oprand1] == 0 && REG[ip->Oprand2] == 0) {
-                            REG[ip->Oprand1] = 0;
-                        } else {
-                            REG[ip->Oprand1] = 1;
-                        }
+                case CALL:
+                    op.Value = ip->Oprand2;
+                    op.Target = findOp(ip->Oprand1);
+                    break;
+                case RET:
+                case RETV:
+                    if ((ip->OpCode == RET || isValidRegister(ip->Oprand1)) && ip->Oprand2 >= 0 && ip->Oprand2 <= memSize - FIX_LENGTH) {
+                        op.Reg1 = ip->OpCode == RETV ? & REG[ip->Oprand1] : nullptr;
+                        op.Target = findOp(ip->Oprand2);
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case CMP:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 < REG_SIZE) {
-                        REG[ip->Oprand1] -= REG[ip->Oprand2];
+                case TRP:
+                    if (ip->Oprand1 >= 0 && ip->Oprand1 <= 6) {
+                        op.Value = ip->Oprand1;
                     } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
+                        op.OpCode = ERR_OPRAND;
                     }
                     break;
-                case TRP:
-                    REG[8] += FIX_LENGTH;
-                    switch (ip -> Oprand1) {
-                        case 0:
-                            programStop = true;
-                            break;
-                        case 1:
-                            std::cout << REG[3];
-                            break;
-                        case 2:
-                            std::cin >> REG[3];
-                            break;
-                        case 3:
-                            std::cout << static_cast<char>(REG[3]);
-                            break;
+                case NOP:
+                    break;
+                default:
+                    op.OpCode = ERR_OPCODE;
+                    break;
+            }
+        }
+        fuseSuperInstructions();
+    }
+    
+    // sequences picked from D_Profile runs of the sample programs, longest first.
+    // The entry for a superinstruction is at OpCode - SUPER_FIRST.
+    static const SuperInstruction * superInstructionTable() {
+        static const SuperInstruction table[] = {
+            { STRO_LDRO_LDRO, 3, { STRO, LDRO, LDRO } },
+            { LDRO_LDR_CMP, 3, { LDRO, LDR, CMP } },
+            { LDR_MUL_ADD, 3, { LDR, MUL, ADD } },
+            { STRO_LDRO, 2, { STRO, LDRO, 0 } },
+            { LDRO_LDRO, 2, { LDRO, LDRO, 0 } },
+            { LDRO_LDR, 2, { LDRO, LDR, 0 } },
+            { MOV_LDRO, 2, { MOV, LDRO, 0 } },
+            { MOV_MOV, 2, { MOV, MOV, 0 } },
+            { LDR_CMP, 2, { LDR, CMP, 0 } },
+            { ADD_STRO, 2, { ADD, STRO, 0 } },
+            { MUL_MOV, 2, { MUL, MOV, 0 } },
+            { LDR_ADD, 2, { LDR, ADD, 0 } },
+            { LDRO_FRAME, 2, { LDRO, FRAME, 0 } },
+            { 0, 0, { 0, 0, 0 } }
+        };
+        return table;
+    }
+    
+    // the opcode of the instruction itself, also for the first one of a superinstruction
+    static int plainOpCode(const DecodedOp & op) {
+        return op.OpCode >= SUPER_FIRST ? superInstructionTable()[op.OpCode - SUPER_FIRST].Sequence[0] : op.OpCode;
+    }
+    
+    bool isSuperInstruction(const std::string & sequence) {
+        for (const SuperInstruction * super = superInstructionTable(); super->OpCode != 0; super++) {
+            std::string name = opCodeName(super->Sequence[0]);
+            for (int k = 1; k < super->Length; k++) name += std::string(" ") + opCodeName(super->Sequence[k]);
+            if (name == sequence) return true;
+        }
+        return false;
+    }
+    
+    // the loader's last step: let the first instruction of every known sequence dispatch
+    // as its superinstruction. The instructions after it are left as they are, so jumps
+    // into the middle still work and the superinstruction reads their operands from them.
+    void fuseSuperInstructions() {
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            for (const SuperInstruction * super = superInstructionTable(); super->OpCode != 0; super++) {
+                int k = 0;
+                while (k < super->Length && i + k < static_cast<int>(program.size()) && plainOpCode(program[i + k]) == super->Sequence[k]) k++;
+                if (k == super->Length) {
+                    program[i].OpCode = super->OpCode;
+                    break;
+                }
+            }
+        }
+    }
+    
+    // find the decoded instruction at an address, or the ERR_OPCODE sentinel if there is none
+    DecodedOp * findOp(int addr) {
+        if (addr < 0 || addr >= static_cast<int>(codeIndex.size())) {
+            return & program.back();
+        }
+        return codeIndex[addr];
+    }
+    
+    std::string cReg(int * reg) {
+        return "REG[" + std::to_string(reg - REG) + "]";
+    }
+    
+    std::string cLabel(DecodedOp * op) {
+        return "L" + std::to_string(op - & program[0]);
+    }
+    
+    // the C of a memory check on size bytes at address, followed by the indent of the
+    // next statement, or nothing if checked is off
+    std::string cMemoryCheck(DecodedOp * ip, std::string address, int size, bool checked) {
+        if (!checked) return "";
+        return "if (!inMemory(" + address + ", " + std::to_string(size) + ")) {\n"
+            + "        REG[8] = " + std::to_string(ip->Addr) + ";\n        printf(\"Memory Access Error!\\n\");\n        return 0;\n    }\n    ";
+    }
+    
+    // translate the loaded program to a standalone C file: every instruction becomes
+    // a labelled C statement over REG and MEM, the MEM image becomes an initializer
+    bool saveCSource(std::string fileName) {
+        std::ofstream targetFile(fileName, std::ios::out | std::ios::trunc);
+        if (!targetFile.is_open()) {
+            std::cout << "Cannot open the file: " << fileName << std::endl;
+            return false;
+        }
+        targetFile << "/* translated from a KXI VM program */\n";
+        targetFile << "#include <stdio.h>\n#include <string.h>\n\n";
+        targetFile << "#define MEM_SIZE " << memSize << "\n\n";
+        targetFile << "int REG[" << REG_SIZE << "];\n";
+        targetFile << "char MEM[MEM_SIZE];\n\n";
+        targetFile << "static const unsigned char IMAGE[" << (memoryUsedCount > 0 ? memoryUsedCount : 1) << "] = {";
+        for (int i = 0; i < memoryUsedCount; i++) {
+            if (i % 20 == 0) targetFile << "\n   ";
+            targetFile << " " << static_cast<int>(static_cast<unsigned char>(MEM[i])) << ",";
+        }
+        targetFile << "\n};\n\n";
+        targetFile << "static int getInt(int addr) {\n    int value;\n    memcpy(&value, &MEM[addr], sizeof value);\n    return value;\n}\n\n";
+        targetFile << "static void setInt(int addr, int value) {\n    memcpy(&MEM[addr], &value, sizeof value);\n}\n\n";
+        targetFile << "static int difference(int x, int y) {\n    return (int)((unsigned int)x - (unsigned int)y);\n}\n\n";
+        targetFile << "static int inMemory(int addr, int size) {\n    return (unsigned int)addr <= (unsigned int)(MEM_SIZE - size);\n}\n\n";
+        // the allocator of TRP 5 and TRP 6, see allocate and release
+        targetFile << "#define HEAP_BASE " << memoryUsedCount << "\n";
+        targetFile << "static int FREE_LIST[" << HEAP_CLASS_COUNT + 1 << "];\n\n";
+        targetFile << "static int heapClassSize(int sizeClass) {\n    if (sizeClass < " << HEAP_SMALL_CLASSES << ") return 8 * (sizeClass + 1);\n";
+        targetFile << "    return " << 8 * HEAP_SMALL_CLASSES << " << (sizeClass - " << HEAP_SMALL_CLASSES - 1 << ");\n}\n\n";
+        targetFile << "static int heapBlockSize(int header) {\n    return header < " << HEAP_CLASS_COUNT << " ? heapClassSize(header) : header;\n}\n\n";
+        targetFile << "static int allocate(int size) {\n    int header = 0;\n    int block;\n    int previous = 0;\n";
+        targetFile << "    if (size < 0 || size > MEM_SIZE) return 0;\n";
+        targetFile << "    if (size > " << HEAP_LARGE_SIZE << ") {\n        header = (size + 7) / 8 * 8;\n";
+        targetFile << "        for (block = FREE_LIST[" << HEAP_CLASS_COUNT << "]; block != 0 && ~getInt(block - " << INT_SIZE << ") < header; block = getInt(block)) previous = block;\n";
+        targetFile << "        if (block != 0) {\n            header = ~getInt(block - " << INT_SIZE << ");\n";
+        targetFile << "            if (previous == 0) FREE_LIST[" << HEAP_CLASS_COUNT << "] = getInt(block);\n            else setInt(previous, getInt(block));\n        }\n    }\n";
+        targetFile << "    else {\n        while (heapClassSize(header) < size) header++;\n";
+        targetFile << "        block = FREE_LIST[header];\n        if (block != 0) FREE_LIST[header] = getInt(block);\n    }\n";
+        targetFile << "    if (block == 0) {\n        if (difference(REG[10], REG[9]) < " << INT_SIZE << " + heapBlockSize(header)) return 0;\n";
+        targetFile << "        block = REG[9] + " << INT_SIZE << ";\n        REG[9] = block + heapBlockSize(header);\n    }\n";
+        targetFile << "    setInt(block - " << INT_SIZE << ", header);\n    memset(&MEM[block], 0, size);\n    return block;\n}\n\n";
+        targetFile << "static int release(int addr) {\n    int header;\n    int list;\n    if (addr == 0) return 1;\n";
+        targetFile << "    if (difference(addr, HEAP_BASE) < " << INT_SIZE << " || difference(REG[9], addr) < heapClassSize(0)) return 0;\n";
+        targetFile << "    header = getInt(addr - " << INT_SIZE << ");\n";
+        targetFile << "    if (header < 0 || (header >= " << HEAP_CLASS_COUNT << " && header <= " << HEAP_LARGE_SIZE << ") || difference(REG[9], addr) < heapBlockSize(header)) return 0;\n";
+        targetFile << "    list = header < " << HEAP_CLASS_COUNT << " ? header : " << HEAP_CLASS_COUNT << ";\n";
+        targetFile << "    setInt(addr - " << INT_SIZE << ", ~header);\n    setInt(addr, FREE_LIST[list]);\n";
+        targetFile << "    FREE_LIST[list] = addr;\n    return 1;\n}\n\n";
+        targetFile << "static int readInt(void) {\n    int value = 0;\n    if (scanf(\"%d\", &value) != 1) value = 0;\n    return value;\n}\n\n";
+        targetFile << "int main(void) {\n";
+        targetFile << "    int target;\n";
+        targetFile << "    memcpy(MEM, IMAGE, " << memoryUsedCount << ");\n";
+        targetFile << "    REG[8] = 0;\n";
+        targetFile << "    REG[9] = " << memoryUsedCount << ";\n";
+        targetFile << "    REG[12] = MEM_SIZE - 4;\n";
+        targetFile << "    REG[10] = REG[12];\n";
+        targetFile << "    REG[11] = REG[10];\n";
+        targetFile << "    goto " << cLabel(findOp(0)) << ";\n";
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            DecodedOp * ip = & program[i];
+            targetFile << cLabel(ip) << ":\n    ";
+            int opcode = plainOpCode(*ip);
+            if (opcode >= STRI && opcode <= LDBO) {
+                std::string address = cReg(ip->Reg2) + (opcode >= STRO ? " + " + std::to_string(ip->Value) : "");
+                targetFile << cMemoryCheck(ip, address, opcode == STRI || opcode == LDRI || opcode == STRO || opcode == LDRO ? INT_SIZE : 1, opcode < STRO || memoryChecks || ip->Reg2 != & REG[11]);
+            }
+            switch (opcode) {
+                case JMP:
+                    targetFile << "goto " << cLabel(ip->Target) << ";";
+                    break;
+                case JMR:
+                    targetFile << "target = " << cReg(ip->Reg1) << ";\n    goto dispatch;";
+                    break;
+                case BNZ:
+                    targetFile << "if (" << cReg(ip->Reg1) << " != 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BGT:
+                    targetFile << "if (" << cReg(ip->Reg1) << " > 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BLT:
+                    targetFile << "if (" << cReg(ip->Reg1) << " < 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BRZ:
+                    targetFile << "if (" << cReg(ip->Reg1) << " == 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BLTR:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) < 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BGTR:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) > 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BEQR:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) == 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BNER:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) != 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BLER:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) <= 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case BGER:
+                    targetFile << "if (difference(" << cReg(ip->Reg1) << ", REG[" << ip->Value << "]) >= 0) goto " << cLabel(ip->Target) << ";";
+                    break;
+                case MOV:
+                    targetFile << cReg(ip->Reg1) << " = " << cReg(ip->Reg2) << ";";
+                    break;
+                case LDA:
+                    targetFile << cReg(ip->Reg1) << " = " << ip->Value << ";";
+                    break;
+                case STR:
+                    targetFile << "setInt(" << (ip->Mem - MEM) << ", " << cReg(ip->Reg1) << ");";
+                    break;
+                case LDR:
+                    targetFile << cReg(ip->Reg1) << " = getInt(" << (ip->Mem - MEM) << ");";
+                    break;
+                case STB:
+                    targetFile << "MEM[" << (ip->Mem - MEM) << "] = (char)" << cReg(ip->Reg1) << ";";
+                    break;
+                case LDB:
+                    targetFile << cReg(ip->Reg1) << " = (int)MEM[" << (ip->Mem - MEM) << "];";
+                    break;
+                case ADD:
+                    targetFile << cReg(ip->Reg1) << " += " << cReg(ip->Reg2) << ";";
+                    break;
+                case ADI:
+                    targetFile << cReg(ip->Reg1) << " += " << ip->Value << ";";
+                    break;
+                case SUB:
+                case CMP:
+                    targetFile << cReg(ip->Reg1) << " -= " << cReg(ip->Reg2) << ";";
+                    break;
+                case MUL:
+                    targetFile << cReg(ip->Reg1) << " *= " << cReg(ip->Reg2) << ";";
+                    break;
+                case DIV:
+                    targetFile << cReg(ip->Reg1) << " /= " << cReg(ip->Reg2) << ";";
+                    break;
+                case AND:
+                    targetFile << cReg(ip->Reg1) << " = (" << cReg(ip->Reg1) << " == 0 || " << cReg(ip->Reg2) << " == 0) ? 0 : 1;";
+                    break;
+                case OR:
+                    targetFile << cReg(ip->Reg1) << " = (" << cReg(ip->Reg1) << " == 0 && " << cReg(ip->Reg2) << " == 0) ? 0 : 1;";
+                    break;
+                case TRP:
+                    switch (ip->Value) {
+                        case 0:
+                            targetFile << "REG[8] = " << ip->Addr + FIX_LENGTH << ";\n    return 0;";
+                            break;
+                        case 1:
+                            targetFile << "printf(\"%d\", REG[3]);";
+                            break;
+                        case 2:
+                            targetFile << "REG[3] = readInt();";
+                            break;
+                        case 3:
+                            targetFile << "putchar((char)REG[3]);";
+                            break;
                         case 4:
-                            REG[3] = getchar();
+                            targetFile << "REG[3] = getchar();";
+                            break;
+                        case 5:
+                            targetFile << "REG[3] = allocate(REG[3]);";
+                            break;
+                        case 6:
+                            targetFile << "if (!release(REG[3])) {\n        REG[8] = " << ip->Addr << ";\n        printf(\"Heap Free Error!\\n\");\n        return 0;\n    }";
                             break;
-                        default:
-                            std::cout << "Unexpected Error!" << std::endl;
-                            return;
                     }
                     break;
                 case STRI:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 <= REG_SIZE) {
-                        int *p = reinterpret_cast<int *>(&MEM[REG[ip->Oprand2]]);
-                        *p = REG[ip->Oprand1];
-                   } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
+                    targetFile << "setInt(" << cReg(ip->Reg2) << ", " << cReg(ip->Reg1) << ");";
                     break;
                 case LDRI:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 <= REG_SIZE) {
-                        int *p = reinterpret_cast<int *>(&MEM[REG[ip->Oprand2]]);
-                        REG[ip->Oprand1] = *p;
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
+                    targetFile << cReg(ip->Reg1) << " = getInt(" << cReg(ip->Reg2) << ");";
                     break;
                 case STBI:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 <= REG_SIZE) {
-                        MEM[REG[ip->Oprand2]] = static_cast<char>(REG[ip->Oprand1]);
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
+                    targetFile << "MEM[" << cReg(ip->Reg2) << "] = (char)" << cReg(ip->Reg1) << ";";
                     break;
                 case LDBI:
-                    REG[8] += FIX_LENGTH;
-                    if (ip->Oprand1 >= 0 && ip->Oprand1 < REG_SIZE && ip->Oprand2 >= 0 && ip->Oprand2 <= REG_SIZE) {
-                        REG[ip->Oprand1] = 0; // clear the register
-                        REG[ip->Oprand1] = static_cast<int>(MEM[REG[ip->Oprand2]]);
-                    } else {
-                        std::cout << "Unexpected Error!" << std::endl;
-                        return;
-                    }
+                    targetFile << cReg(ip->Reg1) << " = (int)MEM[" << cReg(ip->Reg2) << "];";
+                    break;
+                case STRO:
+                    targetFile << "setInt(" << cReg(ip->Reg2) << " + " << ip->Value << ", " << cReg(ip->Reg1) << ");";
+                    break;
+                case LDRO:
+                    targetFile << cReg(ip->Reg1) << " = getInt(" << cReg(ip->Reg2) << " + " << ip->Value << ");";
+                    break;
+                case STBO:
+                    targetFile << "MEM[" << cReg(ip->Reg2) << " + " << ip->Value << "] = (char)" << cReg(ip->Reg1) << ";";
+                    break;
+                case LDBO:
+                    targetFile << cReg(ip->Reg1) << " = (int)MEM[" << cReg(ip->Reg2) << " + " << ip->Value << "];";
+                    break;
+                case PUSH:
+                    targetFile << cMemoryCheck(ip, "REG[10]", INT_SIZE, memoryChecks);
+                    targetFile << "setInt(REG[10], " << cReg(ip->Reg1) << ");\n    REG[10] -= " << INT_SIZE << ";";
+                    break;
+                case POP:
+                    targetFile << cMemoryCheck(ip, "REG[10] + " + std::to_string(INT_SIZE), INT_SIZE, memoryChecks);
+                    targetFile << "REG[10] += " << INT_SIZE << ";\n    " << cReg(ip->Reg1) << " = getInt(REG[10]);";
+                    break;
+                case FRAME:
+                case FRAMEG:
+                    // there are no guard pages in the C program, FRAMEG keeps the test
+                    targetFile << "if (difference(REG[10] - " << ip->Value << ", REG[9]) < 0) goto " << cLabel(ip->Target) << ";\n    ";
+                    targetFile << cMemoryCheck(ip, "REG[10] - 8", 2 * INT_SIZE, memoryChecks);
+                    targetFile << "setInt(REG[10] - 4, REG[11]);\n    setInt(REG[10] - 8, " << cReg(ip->Reg1) << ");\n    REG[10] -= 12;";
+                    break;
+                case CALL:
+                    targetFile << cMemoryCheck(ip, "REG[10] + " + std::to_string(ip->Value), INT_SIZE, memoryChecks);
+                    targetFile << "REG[11] = REG[10] + " << ip->Value << ";\n    setInt(REG[11], " << ip->Addr + FIX_LENGTH << ");\n    goto " << cLabel(ip->Target) << ";";
+                    break;
+                case RET:
+                case RETV:
+                    targetFile << "REG[10] = REG[11];\n    if (difference(REG[11], REG[12]) > 0) goto " << cLabel(ip->Target) << ";\n    ";
+                    targetFile << cMemoryCheck(ip, "REG[11] - 4", 2 * INT_SIZE, memoryChecks);
+                    targetFile << "target = getInt(REG[11]);\n";
+                    if (opcode == RETV) targetFile << "    setInt(REG[11], " << cReg(ip->Reg1) << ");\n";
+                    targetFile << "    REG[11] = getInt(REG[11] - 4);\n    goto dispatch;";
                     break;
                 case NOP:
-                    REG[8] += FIX_LENGTH;
+                    targetFile << ";";
+                    break;
+                case ERR_OPRAND:
+                    targetFile << "REG[8] = " << ip->Addr << ";\n    printf(\"Unexpected Error!\\n\");\n    return 0;";
                     break;
                 default:
-                    std::cout << "Unexpected OpCode Error!" << std::endl;
-                    return;
+                    targetFile << "REG[8] = " << ip->Addr << ";\n    printf(\"Unexpected OpCode Error!\\n\");\n    return 0;";
+                    break;
+            }
+            targetFile << "\n";
+        }
+        // JMR targets are only known at run time, jump through every instruction address
+        targetFile << "dispatch:\n    switch (target) {\n";
+        for (int i = 0; i < static_cast<int>(program.size()) - 1; i++) {
+            if (codeIndex[program[i].Addr] == & program[i]) {
+                targetFile << "        case " << program[i].Addr << ": goto " << cLabel(& program[i]) << ";\n";
+            }
+        }
+        targetFile << "        default: goto " << cLabel(& program.back()) << ";\n    }\n}\n";
+        targetFile.close();
+        return true;
+    }
+    
+    void setDispatchMode(DispatchMode mode) {
+        dispatchMode = mode;
+    }
+    
+    // handle a TRP instruction, return true if the program should stop
+    bool trap(int code) {
+        switch (code) {
+            case 0:
+                return true;
+            case 1:
+                std::cout << REG[3];
+                break;
+            case 2:
+                std::cin >> REG[3];
+                break;
+            case 3:
+                std::cout << static_cast<char>(REG[3]);
+                break;
+            case 4:
+                REG[3] = getchar();
+                break;
+            case 5:
+                REG[3] = allocate(REG[3]);
+                break;
+            case 6:
+                if (!release(REG[3])) {
+                    std::cout << "Heap Free Error!" << std::endl;
+                    return true;
+                }
+                break;
+        }
+        return false;
+    }
+    
+    static int heapClassSize(int sizeClass) {
+        if (sizeClass < HEAP_SMALL_CLASSES) return 8 * (sizeClass + 1);
+        return (8 * HEAP_SMALL_CLASSES) << (sizeClass - HEAP_SMALL_CLASSES + 1);
+    }
+    
+    // smallest size class whose blocks hold size bytes, size is at most HEAP_LARGE_SIZE
+    static int heapClass(int size) {
+        if (size <= 8 * HEAP_SMALL_CLASSES) return size <= 8 ? 0 : (size + 7) / 8 - 1;
+        int sizeClass = HEAP_SMALL_CLASSES;
+        while (heapClassSize(sizeClass) < size) sizeClass++;
+        return sizeClass;
+    }
+    
+    // bytes of a block from its header, a size class or the size of a large block
+    static int heapBlockSize(int header) {
+        return header < HEAP_CLASS_COUNT ? heapClassSize(header) : header;
+    }
+    
+    // TRP 5: size zeroed bytes, taken from the free list of their size class or else from
+    // the top of the heap, 0 if the heap would run into the stack (or the guard pages).
+    // A request above HEAP_LARGE_SIZE reuses the first free large block that holds it, or
+    // else takes its exact size, so a large array costs no more than it needs.
+    // The int before every block holds its class or its large size, release() flips it
+    // to ~header.
+    int allocate(int size) {
+        if (size < 0 || size > memSize) return 0;
+        int header;
+        int block;
+        if (size > HEAP_LARGE_SIZE) {
+            header = (size + 7) / 8 * 8;
+            block = takeLargeBlock(header);
+            if (block != 0) header = ~getInt(block - INT_SIZE);
+        }
+        else {
+            header = heapClass(size);
+            block = freeList[header];
+            if (block != 0) freeList[header] = getInt(block);
+        }
+        if (block == 0) {
+            // in guard mode the guard pages move up with the heap top and may not reach the stack
+            int reserve = guardArmed ? GUARD_SIZE + pageSize : 0;
+            if (difference(REG[10], REG[9]) < reserve + INT_SIZE + heapBlockSize(header)) return 0;
+            block = REG[9] + INT_SIZE;
+#ifdef VM_GUARD_PAGES
+            if (guardArmed && !moveGuard(block + heapBlockSize(header))) return 0;
+#endif
+            REG[9] = block + heapBlockSize(header);
+        }
+        setInt(block - INT_SIZE, header);
+        memset(MEM + block, 0, size);
+        return block;
+    }
+    
+    // unlink the first free large block of at least size bytes, 0 if there is none
+    int takeLargeBlock(int size) {
+        int previous = 0;
+        for (int block = freeList[HEAP_CLASS_COUNT]; block != 0; block = getInt(block)) {
+            if (~getInt(block - INT_SIZE) >= size) {
+                if (previous == 0) freeList[HEAP_CLASS_COUNT] = getInt(block);
+                else setInt(previous, getInt(block));
+                return block;
+            }
+            previous = block;
+        }
+        return 0;
+    }
+    
+    // TRP 6: give a block from allocate() back to its size class, or to the large blocks,
+    // so a later allocation reuses it. Null is ignored, false if addr is no block in use.
+    bool release(int addr) {
+        if (addr == 0) return true;
+        if (difference(addr, heapBase) < INT_SIZE || difference(REG[9], addr) < heapClassSize(0)) return false;
+        int header = getInt(addr - INT_SIZE);
+        if (header < 0 || (header >= HEAP_CLASS_COUNT && header <= HEAP_LARGE_SIZE)
+            || difference(REG[9], addr) < heapBlockSize(header)) return false;
+        int list = header < HEAP_CLASS_COUNT ? header : HEAP_CLASS_COUNT;
+        setInt(addr - INT_SIZE, ~header);
+        setInt(addr, freeList[list]);
+        freeList[list] = addr;
+        return true;
+    }
+    
+    // FRAME: reserve the whole activation record or jump to the overflow handler,
+    // then save FP as the PFP and the this pointer below the return address slot.
+    // With checked set the stack instructions also keep their slots inside MEM, so
+    // SP, FP and SB changed by hand cannot reach outside it.
+    template <bool checked>
+    DecodedOp * enterFrame(DecodedOp * ip) {
+        if (difference(REG[10] - ip->Value, REG[9]) < 0) return ip->Target;
+        if (checked && !inMemory(REG[10] - 2 * INT_SIZE, 2 * INT_SIZE)) return memoryFault(ip);
+        setInt(REG[10] - INT_SIZE, REG[11]);
+        setInt(REG[10] - 2 * INT_SIZE, *ip->Reg1);
+        REG[10] -= 3 * INT_SIZE;
+        return ip + 1;
+    }
+    
+    // FRAMEG: FRAME without the test, a record running into the guard pages faults on its
+    // first store there
+    template <bool checked>
+    DecodedOp * enterGuardedFrame(DecodedOp * ip) {
+        if (checked && !inMemory(REG[10] - 2 * INT_SIZE, 2 * INT_SIZE)) return memoryFault(ip);
+        setInt(REG[10] - INT_SIZE, REG[11]);
+        setInt(REG[10] - 2 * INT_SIZE, *ip->Reg1);
+        REG[10] -= 3 * INT_SIZE;
+        return ip + 1;
+    }
+    
+    // CALL: the frame starts at the return address slot, Value bytes above SP
+    template <bool checked>
+    DecodedOp * callFrame(DecodedOp * ip) {
+        if (checked && !inMemory(REG[10] + ip->Value, INT_SIZE)) return memoryFault(ip);
+        REG[11] = REG[10] + ip->Value;
+        setInt(REG[11], ip->Addr + FIX_LENGTH);
+        return ip->Target;
+    }
+    
+    // RET/RETV: drop the frame, leave the return value in the return address slot
+    // for the caller to read at SP, restore FP from the PFP and jump back
+    template <bool checked>
+    DecodedOp * returnFrame(DecodedOp * ip) {
+        REG[10] = REG[11];
+        if (difference(REG[11], REG[12]) > 0) return ip->Target;
+        if (checked && !inMemory(REG[11] - INT_SIZE, 2 * INT_SIZE)) return memoryFault(ip);
+        int returnAddr = getInt(REG[11]);
+        if (ip->Reg1 != nullptr) setInt(REG[11], *ip->Reg1);
+        REG[11] = getInt(REG[11] - INT_SIZE);
+        return findOp(returnAddr);
+    }
+    
+    // one instruction of a superinstruction, the same work as its case in runSwitch().
+    // opcode is a constant, so only that case is left once this is inlined.
+    template <int opcode, bool checked>
+    DecodedOp * step(DecodedOp * ip) {
+        switch (opcode) {
+            case MOV:
+                *ip->Reg1 = *ip->Reg2;
+                break;
+            case LDR:
+                *ip->Reg1 = *reinterpret_cast<int *>(ip->Mem);
+                break;
+            case ADD:
+                *ip->Reg1 += *ip->Reg2;
+                break;
+            case CMP:
+                *ip->Reg1 -= *ip->Reg2;
+                break;
+            case MUL:
+                *ip->Reg1 *= *ip->Reg2;
+                break;
+            case STRO:
+                if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) return memoryFault(ip);
+                *reinterpret_cast<int *>(& MEM[*ip->Reg2 + ip->Value]) = *ip->Reg1;
+                break;
+            case LDRO:
+                if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) return memoryFault(ip);
+                *ip->Reg1 = *reinterpret_cast<int *>(& MEM[*ip->Reg2 + ip->Value]);
+                break;
+            case FRAME:
+                return enterFrame<checked>(ip);
+        }
+        return ip + 1;
+    }
+    
+    // the instructions of a superinstruction, each with its own operands
+    template <bool checked, int first, int second, int third = NOP>
+    DecodedOp * superStep(DecodedOp * ip) {
+        ip = step<first, checked>(ip);
+        if (ip == & faultOp) return ip;
+        ip = step<second, checked>(ip);
+        if (third != NOP && ip != & faultOp) ip = step<third, checked>(ip);
+        return ip;
+    }
+    
+    // base + displacement accesses relative to FP skip their bound check in a trusted
+    // program, whose FRAME and RET tests keep FP between SL and SB
+    template <bool checked>
+    bool checksBase(DecodedOp * ip) {
+        return checked || ip->Reg2 != & REG[11];
+    }
+    
+    // addresses addr to addr + size - 1 are all in MEM
+    bool inMemory(int addr, int size) {
+        return static_cast<unsigned int>(addr) <= static_cast<unsigned int>(memSize - size);
+    }
+    
+    // a checked access at ip is out of MEM: continue at faultOp, which stops the program
+    DecodedOp * memoryFault(DecodedOp * ip) {
+        faultOp.Addr = ip->Addr;
+        return & faultOp;
+    }
+    
+    void run() {
+        REG[8] = 0; // setting the PC register, start from MEM[0]
+        REG[9] = memoryUsedCount; // setting the SL register next to the last used byte
+        REG[12] = memSize - 4; // setting the SB register to the last slot of Memory
+        REG[10] = REG[12]; // setting the SP register
+        REG[11] = REG[10]; // setting the FP register, first pointing to out of memory
+        heapBase = REG[9];
+        freeList.assign(HEAP_CLASS_COUNT + 1, 0);
+        dispatchCount = 0;
+        pairCount.assign(dispatchMode == D_Profile ? program.size() : 0, 0);
+        tripleCount.assign(pairCount.size(), 0);
+#ifdef VM_GUARD_PAGES
+        if (guardPages) {
+            if (!armGuard()) {
+                std::cout << "Guard Pages Error!" << std::endl;
+                return;
+            }
+            if (sigsetjmp(guardJump(), 1) != 0) {
+                // the stack ran into the guard pages, the engine starts over at OVERFLOW
+                REG[8] = overflowOp->Addr;
+            }
+        }
+#endif
+        if (dispatchMode == D_JIT) {
+            if (!runJIT()) runThreaded();
+        }
+        else if (dispatchMode == D_Threaded) {
+            runThreaded();
+        }
+        else if (dispatchMode == D_Profile) {
+            if (!memoryChecks) switchEngine<true, false>();
+            else switchEngine<true, true>();
+            reportProfile(PROFILE_REPORT_SIZE);
+        }
+        else {
+            runSwitch();
+        }
+#ifdef VM_GUARD_PAGES
+        if (guardPages) disarmGuard();
+#endif
+    }
+    
+    // guard mode: the GUARD_SIZE bytes from the first page boundary above SL are protected,
+    // so stack overflows cost no instructions of their own. A FRAME whose record fits in
+    // the guard pages drops its test, and allocate moves the pages up with the heap top.
+    // The heap then stops GUARD_SIZE bytes and up to a page short of SP. Either way the
+    // program continues at its OVERFLOW label. False if this host or the memory size has
+    // no room for it.
+    bool setGuard(bool guard) {
+#ifdef VM_GUARD_PAGES
+        long hostPageSize = sysconf(_SC_PAGESIZE);
+        if (guard && (hostPageSize <= 0 || GUARD_SIZE % hostPageSize != 0 || memSize < 4 * GUARD_SIZE)) return false;
+        guardPages = guard;
+        pageSize = static_cast<int>(hostPageSize);
+        return true;
+#else
+        return !guard;
+#endif
+    }
+    
+#ifdef VM_GUARD_PAGES
+    // the VM whose guard pages guardFault serves, one guarded run at a time
+    static VM *& guardedVM() {
+        static VM * vm = nullptr;
+        return vm;
+    }
+    
+    static sigjmp_buf & guardJump() {
+        static sigjmp_buf jump;
+        return jump;
+    }
+    
+    static struct sigaction & previousAction() {
+        static struct sigaction action;
+        return action;
+    }
+    
+    static void guardFault(int number, siginfo_t * info, void *) {
+        VM * vm = guardedVM();
+        char * addr = static_cast<char *>(info->si_addr);
+        if (vm != nullptr && addr >= vm->MEM + vm->guardStart && addr < vm->MEM + vm->guardStart + GUARD_SIZE) {
+            siglongjmp(guardJump(), 1);
+        }
+        // not ours, the faulting access runs again under the previous handler
+        sigaction(number, & previousAction(), nullptr);
+    }
+    
+    // protect the guard pages from the first page boundary at or above heapTop instead,
+    // false if they would reach SP
+    bool moveGuard(int heapTop) {
+        int start = (heapTop + pageSize - 1) / pageSize * pageSize;
+        if (guardArmed && start == guardStart) return true;
+        if (difference(REG[10], start) < GUARD_SIZE) return false;
+        if (guardArmed && mprotect(MEM + guardStart, GUARD_SIZE, PROT_READ | PROT_WRITE) != 0) return false;
+        guardArmed = mprotect(MEM + start, GUARD_SIZE, PROT_NONE) == 0;
+        guardStart = start;
+        return guardArmed;
+    }
+    
+    // protect the guard pages above the heap, decoding FRAMEG once the program is loaded.
+    // A MOV SL, Rx is left as it is, the guard pages follow SL on the next allocation.
+    bool armGuard() {
+        std::map<std::string, int>::iterator overflow = SymbolTable.find("OVERFLOW");
+        if (overflow == SymbolTable.end()) return false;
+        if (overflowOp == nullptr) {
+            overflowOp = findOp(overflow->second);
+            for (int i = 0; i < static_cast<int>(program.size()); i++) {
+                if (program[i].OpCode == FRAME && program[i].Value >= 0 && program[i].Value <= GUARD_SIZE) {
+                    program[i].OpCode = FRAMEG;
+                }
+            }
+        }
+        if (!moveGuard(REG[9])) return false;
+        struct sigaction action;
+        std::memset(& action, 0, sizeof(action));
+        action.sa_sigaction = & VM::guardFault;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(& action.sa_mask);
+        sigaction(SIGSEGV, & action, & previousAction());
+        guardedVM() = this;
+        return true;
+    }
+    
+    // restore the signal handler and give the guard pages back
+    void disarmGuard() {
+        sigaction(SIGSEGV, & previousAction(), nullptr);
+        guardedVM() = nullptr;
+        if (guardArmed) mprotect(MEM + guardStart, GUARD_SIZE, PROT_READ | PROT_WRITE);
+        guardArmed = false;
+    }
+#endif
+    
+    // false for instructions that may not continue with the next one
+    static bool fallsThrough(int opcode) {
+        switch (opcode) {
+            case JMP: case JMR: case BNZ: case BGT: case BLT: case BRZ:
+            case BLTR: case BGTR: case BEQR: case BNER: case BLER: case BGER:
+            case FRAME: case CALL: case RET: case RETV: case TRP: case FRAMEG:
+            case ERR_OPRAND: case ERR_OPCODE: case ERR_MEMORY:
+                return false;
+            default:
+                return true;
+        }
+    }
+    
+    static const char * opCodeName(int opcode) {
+        static const char * names[] = { "", "JMP", "JMR", "BNZ", "BGT", "BLT", "BRZ", "MOV", "LDA", "STR", "LDR", "STB", "LDB",
+            "ADD", "ADI", "SUB", "MUL", "DIV", "AND", "OR", "CMP", "TRP", "STRI", "LDRI", "STBI", "LDBI",
+            "STRO", "LDRO", "STBO", "LDBO", "BLTR", "BGTR", "BEQR", "BNER", "BLER", "BGER",
+            "PUSH", "POP", "FRAME", "CALL", "RET", "RETV", "FRAMEG" };
+        if (opcode >= 0 && opcode < static_cast<int>(sizeof(names) / sizeof(names[0]))) return names[opcode];
+        return opcode == NOP ? "NOP" : "ERR";
+    }
+    
+    // D_Profile: count ip and the straight runs of instructions that end at it
+    void countDispatch(DecodedOp * ip, DecodedOp *& last, DecodedOp *& beforeLast) {
+        dispatchCount++;
+        if (last != nullptr && ip == last + 1 && fallsThrough(plainOpCode(*last))) {
+            pairCount[last - & program[0]]++;
+            if (beforeLast != nullptr && last == beforeLast + 1 && fallsThrough(plainOpCode(*beforeLast))) {
+                tripleCount[beforeLast - & program[0]]++;
             }
         }
+        beforeLast = last;
+        last = ip;
+    }
+    
+    // D_Profile: the opcode pairs and triples that ran back to back most often, on stderr so
+    // the program's own output is untouched. A superinstruction for a sequence saves one
+    // dispatch per extra instruction every time it runs.
+    void reportProfile(int limit) {
+        std::map<std::string, long long> sequences[2];
+        for (int i = 0; i + 1 < static_cast<int>(program.size()); i++) {
+            std::string pair = std::string(opCodeName(plainOpCode(program[i]))) + " " + opCodeName(plainOpCode(program[i + 1]));
+            if (pairCount[i] > 0) sequences[0][pair] += pairCount[i];
+            if (tripleCount[i] > 0) sequences[1][pair + " " + opCodeName(plainOpCode(program[i + 2]))] += tripleCount[i];
+        }
+        std::cerr << "Profile: " << dispatchCount << " instructions dispatched" << std::endl;
+        for (int n = 0; n < 2; n++) {
+            std::vector<std::pair<long long, std::string>> ranked;
+            for (auto it = sequences[n].begin(); it != sequences[n].end(); it++) {
+                ranked.push_back(std::make_pair(it->second, it->first));
+            }
+            std::sort(ranked.begin(), ranked.end(), [](const std::pair<long long, std::string> & a, const std::pair<long long, std::string> & b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            });
+            std::cerr << (n == 0 ? "pairs" : "triples") << " (runs, dispatches saved if fused):" << std::endl;
+            for (int i = 0; i < static_cast<int>(ranked.size()) && i < limit; i++) {
+                long long saved = ranked[i].first * (n + 1);
+                std::cerr << "  " << ranked[i].second << "\t" << ranked[i].first << "\t"
+                    << (dispatchCount > 0 ? saved * 100 / dispatchCount : 0) << "%"
+                    << (isSuperInstruction(ranked[i].second) ? "\tfused" : "") << std::endl;
+            }
+        }
+    }
+    
+    // a program from our own compiler may be trusted: its stack and frame slots stay
+    // between SL and SB through the FRAME and RET tests, so those accesses run without
+    // bound checks. STRI, LDRI, STBI, LDBI and the base + displacement forms on any other
+    // register, e.g. array elements, are still checked.
+    void setTrusted(bool trusted) {
+        memoryChecks = !trusted;
     }
     
+    void runSwitch() {
+        if (!memoryChecks) switchEngine<false, false>();
+        else switchEngine<false, true>();
+    }
+    
+    // register indices and static addresses were checked by decodeProgram, only the
+    // register addressed accesses are checked here: STRI, LDRI, STBI, LDBI and the
+    // base + displacement forms always, the FP relative ones and the stack slots of
+    // PUSH, POP, FRAME, CALL and RET only when checked is set
+    template <bool profile, bool checked>
+    void switchEngine() {
+        bool programStop = false;
+        DecodedOp * ip = findOp(REG[8]);
+        DecodedOp * last = nullptr;  // profile only: the two instructions run before ip
+        DecodedOp * beforeLast = nullptr;
+        while (!programStop) {
+            if (profile) countDispatch(ip, last, beforeLast);
+            switch (profile ? plainOpCode(*ip) : ip->OpCode) {
+                case JMP:
+                    ip = ip->Target;
+                    break;
+                case JMR:
+                    ip = findOp(*ip->Reg1);
+                    break;
+                case BNZ:
+                    ip = (*ip->Reg1 != 0) ? ip->Target : ip + 1;
+                    break;
+                case BGT:
+                    ip = (*ip->Reg1 > 0) ? ip->Target : ip + 1;
+                    break;
+                case BLT:
+                    ip = (*ip->Reg1 < 0) ? ip->Target : ip + 1;
+                    break;
+                case BRZ:
+                    ip = (*ip->Reg1 == 0) ? ip->Target : ip + 1;
+                    break;
+                case BLTR:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) < 0) ? ip->Target : ip + 1;
+                    break;
+                case BGTR:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) > 0) ? ip->Target : ip + 1;
+                    break;
+                case BEQR:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) == 0) ? ip->Target : ip + 1;
+                    break;
+                case BNER:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) != 0) ? ip->Target : ip + 1;
+                    break;
+                case BLER:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) <= 0) ? ip->Target : ip + 1;
+                    break;
+                case BGER:
+                    ip = (difference(*ip->Reg1, REG[ip->Value]) >= 0) ? ip->Target : ip + 1;
+                    break;
+                case MOV:
+                    *ip->Reg1 = *ip->Reg2;
+                    ip++;
+                    break;
+                case LDA:
+                    *ip->Reg1 = ip->Value;
+                    ip++;
+                    break;
+                case STR:
+                    *reinterpret_cast<int *>(ip->Mem) = *ip->Reg1;
+                    ip++;
+                    break;
+                case LDR:
+                    *ip->Reg1 = *reinterpret_cast<int *>(ip->Mem);
+                    ip++;
+                    break;
+                case STB:
+                    *ip->Mem = static_cast<char>(*ip->Reg1);
+                    ip++;
+                    break;
+                case LDB:
+                    *ip->Reg1 = static_cast<int>(*ip->Mem);
+                    ip++;
+                    break;
+                case ADD:
+                    *ip->Reg1 += *ip->Reg2;
+                    ip++;
+                    break;
+                case ADI:
+                    *ip->Reg1 += ip->Value;
+                    ip++;
+                    break;
+                case SUB:
+                case CMP:
+                    *ip->Reg1 -= *ip->Reg2;
+                    ip++;
+                    break;
+                case MUL:
+                    *ip->Reg1 *= *ip->Reg2;
+                    ip++;
+                    break;
+                case DIV:
+                    *ip->Reg1 /= *ip->Reg2;
+                    ip++;
+                    break;
+                case AND:
+                    *ip->Reg1 = (*ip->Reg1 == 0 || *ip->Reg2 == 0) ? 0 : 1;
+                    ip++;
+                    break;
+                case OR:
+                    *ip->Reg1 = (*ip->Reg1 == 0 && *ip->Reg2 == 0) ? 0 : 1;
+                    ip++;
+                    break;
+                case TRP:
+                    programStop = trap(ip->Value);
+                    ip++;
+                    break;
+                case STRI:
+                    if (!inMemory(*ip->Reg2, INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *reinterpret_cast<int *>(& MEM[*ip->Reg2]) = *ip->Reg1;
+                    ip++;
+                    break;
+                case LDRI:
+                    if (!inMemory(*ip->Reg2, INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *ip->Reg1 = *reinterpret_cast<int *>(& MEM[*ip->Reg2]);
+                    ip++;
+                    break;
+                case STBI:
+                    if (!inMemory(*ip->Reg2, 1)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    MEM[*ip->Reg2] = static_cast<char>(*ip->Reg1);
+                    ip++;
+                    break;
+                case LDBI:
+                    if (!inMemory(*ip->Reg2, 1)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *ip->Reg1 = static_cast<int>(MEM[*ip->Reg2]);
+                    ip++;
+                    break;
+                case STRO:
+                    if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *reinterpret_cast<int *>(& MEM[*ip->Reg2 + ip->Value]) = *ip->Reg1;
+                    ip++;
+                    break;
+                case LDRO:
+                    if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *ip->Reg1 = *reinterpret_cast<int *>(& MEM[*ip->Reg2 + ip->Value]);
+                    ip++;
+                    break;
+                case STBO:
+                    if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, 1)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    MEM[*ip->Reg2 + ip->Value] = static_cast<char>(*ip->Reg1);
+                    ip++;
+                    break;
+                case LDBO:
+                    if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, 1)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    *ip->Reg1 = static_cast<int>(MEM[*ip->Reg2 + ip->Value]);
+                    ip++;
+                    break;
+                case PUSH:
+                    if (checked && !inMemory(REG[10], INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    setInt(REG[10], *ip->Reg1);
+                    REG[10] -= INT_SIZE;
+                    ip++;
+                    break;
+                case POP:
+                    if (checked && !inMemory(REG[10] + INT_SIZE, INT_SIZE)) {
+                        ip = memoryFault(ip);
+                        break;
+                    }
+                    REG[10] += INT_SIZE;
+                    *ip->Reg1 = getInt(REG[10]);
+                    ip++;
+                    break;
+                case FRAME:
+                    ip = enterFrame<checked>(ip);
+                    break;
+                case FRAMEG:
+                    ip = enterGuardedFrame<checked>(ip);
+                    break;
+                case CALL:
+                    ip = callFrame<checked>(ip);
+                    break;
+                case RET:
+                case RETV:
+                    ip = returnFrame<checked>(ip);
+                    break;
+                case STRO_LDRO_LDRO:
+                    ip = superStep<checked, STRO, LDRO, LDRO>(ip);
+                    break;
+                case LDRO_LDR_CMP:
+                    ip = superStep<checked, LDRO, LDR, CMP>(ip);
+                    break;
+                case LDR_MUL_ADD:
+                    ip = superStep<checked, LDR, MUL, ADD>(ip);
+                    break;
+                case STRO_LDRO:
+                    ip = superStep<checked, STRO, LDRO>(ip);
+                    break;
+                case LDRO_LDRO:
+                    ip = superStep<checked, LDRO, LDRO>(ip);
+                    break;
+                case LDRO_LDR:
+                    ip = superStep<checked, LDRO, LDR>(ip);
+                    break;
+                case MOV_LDRO:
+                    ip = superStep<checked, MOV, LDRO>(ip);
+                    break;
+                case MOV_MOV:
+                    ip = superStep<checked, MOV, MOV>(ip);
+                    break;
+                case LDR_CMP:
+                    ip = superStep<checked, LDR, CMP>(ip);
+                    break;
+                case ADD_STRO:
+                    ip = superStep<checked, ADD, STRO>(ip);
+                    break;
+                case MUL_MOV:
+                    ip = superStep<checked, MUL, MOV>(ip);
+                    break;
+                case LDR_ADD:
+                    ip = superStep<checked, LDR, ADD>(ip);
+                    break;
+                case LDRO_FRAME:
+                    ip = superStep<checked, LDRO, FRAME>(ip);
+                    break;
+                case NOP:
+                    ip++;
+                    break;
+                case ERR_OPRAND:
+                    REG[8] = ip->Addr;
+                    std::cout << "Unexpected Error!" << std::endl;
+                    return;
+                case ERR_MEMORY:
+                    REG[8] = ip->Addr;
+                    std::cout << "Memory Access Error!" << std::endl;
+                    return;
+                default:
+                    REG[8] = ip->Addr;
+                    std::cout << "Unexpected OpCode Error!" << std::endl;
+                    return;
+            }
+        }
+        REG[8] = ip->Addr;
+    }
+    
+#ifdef VM_JIT_X86_64
+    // x86-64 JIT: VM registers live in host registers while the translated code runs,
+    // R0-R7 in EBX, ECX, ESI, EDI, R8D-R11D and SL, SP, FP, SB in R12D-R15D.
+    // RBP holds the MEM base, RAX and RDX are scratch. PC is never kept in a register.
+    int jitReg(int * reg) {
+        static const int hostReg[REG_SIZE] = { X_RBX, X_RCX, X_RSI, X_RDI, X_R8, X_R9, X_R10, X_R11, -1, X_R12, X_R13, X_R14, X_R15 };
+        return hostReg[reg - REG];
+    }
+    
+    static int jitTrap(VM * vm, int code) {
+        return vm->trap(code) ? 1 : 0;
+    }
+    
+    // copy the host registers back to REG, using base as the address of REG
+    void jitSpill(X86Emitter & x, int base) {
+        for (int i = 0; i < REG_SIZE; i++) {
+            if (i != 8) x.storeDisp8(jitReg(& REG[i]), base, i * INT_SIZE);
+        }
+    }
+    
+    void jitReload(X86Emitter & x, int base) {
+        for (int i = 0; i < REG_SIZE; i++) {
+            if (i != 8) x.loadDisp8(jitReg(& REG[i]), base, i * INT_SIZE);
+        }
+    }
+    
+    // leave the translated code with a status (0: stopped, 1: ERR_OPRAND, 2: ERR_OPCODE,
+    // 3: ERR_MEMORY) and a final PC
+    void jitExit(X86Emitter & x, std::vector<int> & exitPatches, int status, int pc) {
+        x.movImm(X_RAX, status);
+        x.movImm(X_RDX, pc);
+        exitPatches.push_back(x.jmp());
+    }
+    
+    // RAX = the address in EAX sign extended, leaving with ERR_MEMORY first if checked
+    // is set and it is not inMemory for size bytes
+    void jitAddress(X86Emitter & x, std::vector<int> & exitPatches, int size, DecodedOp * ip, bool checked) {
+        if (checked) {
+            x.cmpImm(X_RAX, memSize - size);
+            int skip = x.jcc(X_CC_BE);
+            jitExit(x, exitPatches, 3, ip->Addr);
+            x.patchRel32(skip, x.size());
+        }
+        x.movsxdRax(X_RAX);
+    }
+    
+    bool compileJIT() {
+        X86Emitter x;
+        std::vector<int> opOffset(program.size());
+        std::vector<std::pair<int, DecodedOp *>> patches;  // rel32 to patch, target instruction
+        std::vector<int> exitPatches;
+        jitTable.assign(codeIndex.size(), nullptr);
+        // prologue: save callee-saved registers, keep RSP 16-byte aligned for calls
+        x.push(X_RBX);
+        x.push(X_RBP);
+        x.push(X_R12);
+        x.push(X_R13);
+        x.push(X_R14);
+        x.push(X_R15);
+        x.byte(0x48); x.byte(0x83); x.byte(0xEC); x.byte(0x08);  // sub rsp, 8
+        x.movImm64(X_RAX, REG);
+        jitReload(x, X_RAX);
+        x.movImm64(X_RBP, MEM);
+        // start at PC, through the same table as JMR
+        x.loadDisp8(X_RAX, X_RAX, 8 * INT_SIZE);
+        x.cmpImm(X_RAX, static_cast<int>(codeIndex.size()));
+        patches.push_back(std::make_pair(x.jcc(X_CC_AE), & program.back()));
+        x.movImm64(X_RDX, jitTable.data());
+        x.byte(0xFF); x.byte(0x24); x.byte(0xC2);  // jmp [rdx + rax * 8]
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            DecodedOp * ip = & program[i];
+            opOffset[i] = x.size();
+            int opcode = plainOpCode(*ip);
+            switch (opcode) {
+                case JMP:
+                    patches.push_back(std::make_pair(x.jmp(), ip->Target));
+                    break;
+                case JMR:
+                    x.regReg(0x89, jitReg(ip->Reg1), X_RAX);
+                    x.cmpImm(X_RAX, static_cast<int>(codeIndex.size()));
+                    patches.push_back(std::make_pair(x.jcc(X_CC_AE), & program.back()));
+                    x.movImm64(X_RDX, jitTable.data());
+                    x.byte(0xFF); x.byte(0x24); x.byte(0xC2);  // jmp [rdx + rax * 8]
+                    break;
+                case BNZ:
+                case BGT:
+                case BLT:
+                case BRZ:
+                {
+                    int cc = opcode == BNZ ? X_CC_NZ : opcode == BGT ? X_CC_G : opcode == BLT ? X_CC_L : X_CC_Z;
+                    x.regReg(0x85, jitReg(ip->Reg1), jitReg(ip->Reg1));
+                    patches.push_back(std::make_pair(x.jcc(cc), ip->Target));
+                }
+                    break;
+                case BLTR:
+                case BGTR:
+                case BEQR:
+                case BNER:
+                case BLER:
+                case BGER:
+                {
+                    static const int fusedCC[] = { X_CC_L, X_CC_G, X_CC_Z, X_CC_NZ, X_CC_LE, X_CC_GE };
+                    // test the sign of the wrapped difference like CMP does, not the overflow-aware jl/jg of cmp
+                    x.regReg(0x89, jitReg(ip->Reg1), X_RAX);
+                    x.regReg(0x29, jitReg(& REG[ip->Value]), X_RAX);
+                    x.regReg(0x85, X_RAX, X_RAX);
+                    patches.push_back(std::make_pair(x.jcc(fusedCC[opcode - BLTR]), ip->Target));
+                }
+                    break;
+                case MOV:
+                    x.regReg(0x89, jitReg(ip->Reg2), jitReg(ip->Reg1));
+                    break;
+                case LDA:
+                    x.movImm(jitReg(ip->Reg1), ip->Value);
+                    break;
+                case STR:
+                    x.regAbs(0x89, jitReg(ip->Reg1), static_cast<int>(ip->Mem - MEM), false);
+                    break;
+                case LDR:
+                    x.regAbs(0x8B, jitReg(ip->Reg1), static_cast<int>(ip->Mem - MEM), false);
+                    break;
+                case STB:
+                    x.regAbs(0x88, jitReg(ip->Reg1), static_cast<int>(ip->Mem - MEM), true);
+                    break;
+                case LDB:
+                    x.movsxAbs(jitReg(ip->Reg1), static_cast<int>(ip->Mem - MEM));
+                    break;
+                case ADD:
+                    x.regReg(0x01, jitReg(ip->Reg2), jitReg(ip->Reg1));
+                    break;
+                case ADI:
+                    x.addImm(jitReg(ip->Reg1), ip->Value);
+                    break;
+                case SUB:
+                case CMP:
+                    x.regReg(0x29, jitReg(ip->Reg2), jitReg(ip->Reg1));
+                    break;
+                case MUL:
+                    x.regReg0F(0xAF, jitReg(ip->Reg1), jitReg(ip->Reg2));
+                    break;
+                case DIV:
+                    x.regReg(0x89, jitReg(ip->Reg1), X_RAX);
+                    x.byte(0x99);  // cdq
+                    x.idiv(jitReg(ip->Reg2));
+                    x.regReg(0x89, X_RAX, jitReg(ip->Reg1));
+                    break;
+                case AND:
+                    x.regReg(0x85, jitReg(ip->Reg1), jitReg(ip->Reg1));
+                    x.setcc(X_CC_NZ, X_RAX);
+                    x.regReg(0x85, jitReg(ip->Reg2), jitReg(ip->Reg2));
+                    x.setcc(X_CC_NZ, X_RDX);
+                    x.byte(0x20); x.byte(0xD0);  // and al, dl
+                    x.movzxAl(jitReg(ip->Reg1));
+                    break;
+                case OR:
+                    x.regReg(0x89, jitReg(ip->Reg1), X_RAX);
+                    x.regReg(0x09, jitReg(ip->Reg2), X_RAX);
+                    x.setcc(X_CC_NZ, X_RAX);
+                    x.movzxAl(jitReg(ip->Reg1));
+                    break;
+                case TRP:
+                    if (ip->Value == 0) {
+                        jitExit(x, exitPatches, 0, ip->Addr + FIX_LENGTH);
+                    }
+                    else {
+                        x.movImm64(X_RAX, REG);
+                        jitSpill(x, X_RAX);
+                        x.movImm64(X_RDI, this);
+                        x.movImm(X_RSI, ip->Value);
+                        x.movImm64(X_RAX, reinterpret_cast<const void *>(& VM::jitTrap));
+                        x.byte(0xFF); x.byte(0xD0);  // call rax
+                        x.movImm64(X_RDX, REG);
+                        jitReload(x, X_RDX);
+                        x.regReg(0x85, X_RAX, X_RAX);
+                        int skip = x.jcc(X_CC_Z);
+                        jitExit(x, exitPatches, 0, ip->Addr + FIX_LENGTH);
+                        x.patchRel32(skip, x.size());
+                    }
+                    break;
+                case STRI:
+                case LDRI:
+                case STBI:
+                case LDBI:
+                    x.regReg(0x89, jitReg(ip->Reg2), X_RAX);
+                    jitAddress(x, exitPatches, opcode == STRI || opcode == LDRI ? INT_SIZE : 1, ip, true);
+                    if (opcode == STRI) x.regIndexed(0x89, jitReg(ip->Reg1), false);
+                    else if (opcode == LDRI) x.regIndexed(0x8B, jitReg(ip->Reg1), false);
+                    else if (opcode == STBI) x.regIndexed(0x88, jitReg(ip->Reg1), true);
+                    else x.movsxIndexed(jitReg(ip->Reg1));
+                    break;
+                case STRO:
+                case LDRO:
+                case STBO:
+                case LDBO:
+                    // the address wraps like the VM's int sum before it is sign extended
+                    x.regReg(0x89, jitReg(ip->Reg2), X_RAX);
+                    x.addImm(X_RAX, ip->Value);
+                    jitAddress(x, exitPatches, opcode == STRO || opcode == LDRO ? INT_SIZE : 1, ip, memoryChecks || ip->Reg2 != & REG[11]);
+                    if (opcode == STRO) x.regIndexed(0x89, jitReg(ip->Reg1), false);
+                    else if (opcode == LDRO) x.regIndexed(0x8B, jitReg(ip->Reg1), false);
+                    else if (opcode == STBO) x.regIndexed(0x88, jitReg(ip->Reg1), true);
+                    else x.movsxIndexed(jitReg(ip->Reg1));
+                    break;
+                case PUSH:
+                    x.regReg(0x89, jitReg(& REG[10]), X_RAX);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.regIndexed(0x89, jitReg(ip->Reg1), false);
+                    x.addImm(jitReg(& REG[10]), -INT_SIZE);
+                    break;
+                case POP:
+                    x.regReg(0x89, jitReg(& REG[10]), X_RAX);
+                    x.addImm(X_RAX, INT_SIZE);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.addImm(jitReg(& REG[10]), INT_SIZE);
+                    x.regIndexed(0x8B, jitReg(ip->Reg1), false);
+                    break;
+                case FRAME:
+                case FRAMEG:
+                    if (opcode == FRAME) {
+                        // same wrapped difference test as the fused branches
+                        x.regReg(0x89, jitReg(& REG[10]), X_RAX);
+                        x.addImm(X_RAX, -ip->Value);
+                        x.regReg(0x29, jitReg(& REG[9]), X_RAX);
+                        x.regReg(0x85, X_RAX, X_RAX);
+                        patches.push_back(std::make_pair(x.jcc(X_CC_L), ip->Target));
+                    }
+                    x.regReg(0x89, jitReg(& REG[10]), X_RAX);
+                    x.addImm(X_RAX, -INT_SIZE);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.regIndexed(0x89, jitReg(& REG[11]), false);
+                    x.regReg(0x89, jitReg(& REG[10]), X_RAX);
+                    x.addImm(X_RAX, -2 * INT_SIZE);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.regIndexed(0x89, jitReg(ip->Reg1), false);
+                    x.addImm(jitReg(& REG[10]), -3 * INT_SIZE);
+                    break;
+                case CALL:
+                    x.regReg(0x89, jitReg(& REG[10]), jitReg(& REG[11]));
+                    x.addImm(jitReg(& REG[11]), ip->Value);
+                    x.regReg(0x89, jitReg(& REG[11]), X_RAX);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.movImm(X_RDX, ip->Addr + FIX_LENGTH);
+                    x.regIndexed(0x89, X_RDX, false);
+                    patches.push_back(std::make_pair(x.jmp(), ip->Target));
+                    break;
+                case RET:
+                case RETV:
+                    x.regReg(0x89, jitReg(& REG[11]), jitReg(& REG[10]));
+                    x.regReg(0x89, jitReg(& REG[11]), X_RAX);
+                    x.regReg(0x29, jitReg(& REG[12]), X_RAX);
+                    x.regReg(0x85, X_RAX, X_RAX);
+                    patches.push_back(std::make_pair(x.jcc(X_CC_G), ip->Target));
+                    // EDX keeps the return address while the value is stored and FP restored
+                    x.regReg(0x89, jitReg(& REG[11]), X_RAX);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.regIndexed(0x8B, X_RDX, false);
+                    if (opcode == RETV) x.regIndexed(0x89, jitReg(ip->Reg1), false);
+                    x.regReg(0x89, jitReg(& REG[11]), X_RAX);
+                    x.addImm(X_RAX, -INT_SIZE);
+                    jitAddress(x, exitPatches, INT_SIZE, ip, memoryChecks);
+                    x.regIndexed(0x8B, jitReg(& REG[11]), false);
+                    x.regReg(0x89, X_RDX, X_RAX);
+                    x.cmpImm(X_RAX, static_cast<int>(codeIndex.size()));
+                    patches.push_back(std::make_pair(x.jcc(X_CC_AE), & program.back()));
+                    x.movImm64(X_RDX, jitTable.data());
+                    x.byte(0xFF); x.byte(0x24); x.byte(0xC2);  // jmp [rdx + rax * 8]
+                    break;
+                case NOP:
+                    break;
+                case ERR_OPRAND:
+                    jitExit(x, exitPatches, 1, ip->Addr);
+                    break;
+                default:
+                    jitExit(x, exitPatches, 2, ip->Addr);
+                    break;
+            }
+        }
+        // shared exit: store PC and the host registers back to REG, restore callee-saved registers
+        int exitAt = x.size();
+        x.byte(0x48); x.byte(0x89); x.byte(0x04); x.byte(0x24);  // mov [rsp], rax
+        x.movImm64(X_RAX, REG);
+        jitSpill(x, X_RAX);
+        x.storeDisp8(X_RDX, X_RAX, 8 * INT_SIZE);
+        x.byte(0x48); x.byte(0x8B); x.byte(0x04); x.byte(0x24);  // mov rax, [rsp]
+        x.byte(0x48); x.byte(0x83); x.byte(0xC4); x.byte(0x08);  // add rsp, 8
+        x.pop(X_R15);
+        x.pop(X_R14);
+        x.pop(X_R13);
+        x.pop(X_R12);
+        x.pop(X_RBP);
+        x.pop(X_RBX);
+        x.byte(0xC3);  // ret
+        for (int i = 0; i < static_cast<int>(patches.size()); i++) {
+            x.patchRel32(patches[i].first, opOffset[patches[i].second - & program[0]]);
+        }
+        for (int i = 0; i < static_cast<int>(exitPatches.size()); i++) {
+            x.patchRel32(exitPatches[i], exitAt);
+        }
+        // map the code, then make it executable but no longer writable
+        void * mem = mmap(nullptr, x.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return false;
+        std::memcpy(mem, x.data(), x.size());
+        if (mprotect(mem, x.size(), PROT_READ | PROT_EXEC) != 0) {
+            munmap(mem, x.size());
+            return false;
+        }
+        jitCode = static_cast<unsigned char *>(mem);
+        jitCodeSize = x.size();
+        for (int i = 0; i < static_cast<int>(codeIndex.size()); i++) {
+            jitTable[i] = jitCode + opOffset[codeIndex[i] - & program[0]];
+        }
+        return true;
+    }
+    
+    // run the program as native code, return false if it cannot be translated
+    bool runJIT() {
+        if (jitCode == nullptr && !compileJIT()) return false;
+        int status = reinterpret_cast<int (*)()>(jitCode)();
+        if (status == 1) {
+            std::cout << "Unexpected Error!" << std::endl;
+        }
+        else if (status == 2) {
+            std::cout << "Unexpected OpCode Error!" << std::endl;
+        }
+        else if (status == 3) {
+            std::cout << "Memory Access Error!" << std::endl;
+        }
+        return true;
+    }
+    
+    void releaseJIT() {
+        if (jitCode != nullptr) {
+            munmap(jitCode, jitCodeSize);
+            jitCode = nullptr;
+            jitCodeSize = 0;
+        }
+    }
+#else
+    bool runJIT() {
+        return false;
+    }
+    
+    void releaseJIT() {
+    }
+#endif
+    
+#ifdef VM_COMPUTED_GOTO
+    void runThreaded() {
+        if (!memoryChecks) threadedEngine<false>();
+        else threadedEngine<true>();
+    }
+    
+    // direct-threaded engine: each handler ends by jumping to the next instruction's label
+    template <bool checked>
+    void threadedEngine() {
+        VM & vm = *this;
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            switch (program[i].OpCode) {
+                case JMP:
+                    program[i].Handler = && L_JMP;
+                    break;
+                case JMR:
+                    program[i].Handler = && L_JMR;
+                    break;
+                case BNZ:
+                    program[i].Handler = && L_BNZ;
+                    break;
+                case BGT:
+                    program[i].Handler = && L_BGT;
+                    break;
+                case BLT:
+                    program[i].Handler = && L_BLT;
+                    break;
+                case BRZ:
+                    program[i].Handler = && L_BRZ;
+                    break;
+                case BLTR:
+                    program[i].Handler = && L_BLTR;
+                    break;
+                case BGTR:
+                    program[i].Handler = && L_BGTR;
+                    break;
+                case BEQR:
+                    program[i].Handler = && L_BEQR;
+                    break;
+                case BNER:
+                    program[i].Handler = && L_BNER;
+                    break;
+                case BLER:
+                    program[i].Handler = && L_BLER;
+                    break;
+                case BGER:
+                    program[i].Handler = && L_BGER;
+                    break;
+                case MOV:
+                    program[i].Handler = && L_MOV;
+                    break;
+                case LDA:
+                    program[i].Handler = && L_LDA;
+                    break;
+                case STR:
+                    program[i].Handler = && L_STR;
+                    break;
+                case LDR:
+                    program[i].Handler = && L_LDR;
+                    break;
+                case STB:
+                    program[i].Handler = && L_STB;
+                    break;
+                case LDB:
+                    program[i].Handler = && L_LDB;
+                    break;
+                case ADD:
+                    program[i].Handler = && L_ADD;
+                    break;
+                case ADI:
+                    program[i].Handler = && L_ADI;
+                    break;
+                case SUB:
+                    program[i].Handler = && L_SUB;
+                    break;
+                case MUL:
+                    program[i].Handler = && L_MUL;
+                    break;
+                case DIV:
+                    program[i].Handler = && L_DIV;
+                    break;
+                case AND:
+                    program[i].Handler = && L_AND;
+                    break;
+                case OR:
+                    program[i].Handler = && L_OR;
+                    break;
+                case CMP:
+                    program[i].Handler = && L_CMP;
+                    break;
+                case STRI:
+                    program[i].Handler = && L_STRI;
+                    break;
+                case LDRI:
+                    program[i].Handler = && L_LDRI;
+                    break;
+                case STBI:
+                    program[i].Handler = && L_STBI;
+                    break;
+                case LDBI:
+                    program[i].Handler = && L_LDBI;
+                    break;
+                case STRO:
+                    program[i].Handler = && L_STRO;
+                    break;
+                case LDRO:
+                    program[i].Handler = && L_LDRO;
+                    break;
+                case STBO:
+                    program[i].Handler = && L_STBO;
+                    break;
+                case LDBO:
+                    program[i].Handler = && L_LDBO;
+                    break;
+                case PUSH:
+                    program[i].Handler = && L_PUSH;
+                    break;
+                case POP:
+                    program[i].Handler = && L_POP;
+                    break;
+                case FRAME:
+                    program[i].Handler = && L_FRAME;
+                    break;
+                case FRAMEG:
+                    program[i].Handler = && L_FRAMEG;
+                    break;
+                case CALL:
+                    program[i].Handler = && L_CALL;
+                    break;
+                case RET:
+                case RETV:
+                    program[i].Handler = && L_RET;
+                    break;
+                case STRO_LDRO_LDRO:
+                    program[i].Handler = && L_STRO_LDRO_LDRO;
+                    break;
+                case LDRO_LDR_CMP:
+                    program[i].Handler = && L_LDRO_LDR_CMP;
+                    break;
+                case LDR_MUL_ADD:
+                    program[i].Handler = && L_LDR_MUL_ADD;
+                    break;
+                case STRO_LDRO:
+                    program[i].Handler = && L_STRO_LDRO;
+                    break;
+                case LDRO_LDRO:
+                    program[i].Handler = && L_LDRO_LDRO;
+                    break;
+                case LDRO_LDR:
+                    program[i].Handler = && L_LDRO_LDR;
+                    break;
+                case MOV_LDRO:
+                    program[i].Handler = && L_MOV_LDRO;
+                    break;
+                case MOV_MOV:
+                    program[i].Handler = && L_MOV_MOV;
+                    break;
+                case LDR_CMP:
+                    program[i].Handler = && L_LDR_CMP;
+                    break;
+                case ADD_STRO:
+                    program[i].Handler = && L_ADD_STRO;
+                    break;
+                case MUL_MOV:
+                    program[i].Handler = && L_MUL_MOV;
+                    break;
+                case LDR_ADD:
+                    program[i].Handler = && L_LDR_ADD;
+                    break;
+                case LDRO_FRAME:
+                    program[i].Handler = && L_LDRO_FRAME;
+                    break;
+                case NOP:
+                    program[i].Handler = && L_NOP;
+                    break;
+                case TRP:
+                    program[i].Handler = && L_TRP;
+                    break;
+                case ERR_OPRAND:
+                    program[i].Handler = && L_ERR_OPRAND;
+                    break;
+                default:
+                    program[i].Handler = && L_ERR_OPCODE;
+                    break;
+            }
+        }
+        faultOp.Handler = && L_ERR_MEMORY;
+        DecodedOp * ip = findOp(REG[8]);
+        goto *ip->Handler;
+    L_JMP:
+        ip = ip->Target;
+        goto *ip->Handler;
+    L_JMR:
+        ip = vm.findOp(*ip->Reg1);
+        goto *ip->Handler;
+    L_BNZ:
+        ip = (*ip->Reg1 != 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BGT:
+        ip = (*ip->Reg1 > 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BLT:
+        ip = (*ip->Reg1 < 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BRZ:
+        ip = (*ip->Reg1 == 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BLTR:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) < 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BGTR:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) > 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BEQR:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) == 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BNER:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) != 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BLER:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) <= 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_BGER:
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) >= 0) ? ip->Target : ip + 1;
+        goto *ip->Handler;
+    L_MOV:
+        *ip->Reg1 = *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_LDA:
+        *ip->Reg1 = ip->Value;
+        ip++;
+        goto *ip->Handler;
+    L_STR:
+        *reinterpret_cast<int *>(ip->Mem) = *ip->Reg1;
+        ip++;
+        goto *ip->Handler;
+    L_LDR:
+        *ip->Reg1 = *reinterpret_cast<int *>(ip->Mem);
+        ip++;
+        goto *ip->Handler;
+    L_STB:
+        *ip->Mem = static_cast<char>(*ip->Reg1);
+        ip++;
+        goto *ip->Handler;
+    L_LDB:
+        *ip->Reg1 = static_cast<int>(*ip->Mem);
+        ip++;
+        goto *ip->Handler;
+    L_ADD:
+        *ip->Reg1 += *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_ADI:
+        *ip->Reg1 += ip->Value;
+        ip++;
+        goto *ip->Handler;
+    L_SUB:
+        *ip->Reg1 -= *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_MUL:
+        *ip->Reg1 *= *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_DIV:
+        *ip->Reg1 /= *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_AND:
+        *ip->Reg1 = (*ip->Reg1 == 0 || *ip->Reg2 == 0) ? 0 : 1;
+        ip++;
+        goto *ip->Handler;
+    L_OR:
+        *ip->Reg1 = (*ip->Reg1 == 0 && *ip->Reg2 == 0) ? 0 : 1;
+        ip++;
+        goto *ip->Handler;
+    L_CMP:
+        *ip->Reg1 -= *ip->Reg2;
+        ip++;
+        goto *ip->Handler;
+    L_STRI:
+        if (!inMemory(*ip->Reg2, INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2]) = *ip->Reg1;
+        ip++;
+        goto *ip->Handler;
+    L_LDRI:
+        if (!inMemory(*ip->Reg2, INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *ip->Reg1 = *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2]);
+        ip++;
+        goto *ip->Handler;
+    L_STBI:
+        if (!inMemory(*ip->Reg2, 1)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        vm.MEM[*ip->Reg2] = static_cast<char>(*ip->Reg1);
+        ip++;
+        goto *ip->Handler;
+    L_LDBI:
+        if (!inMemory(*ip->Reg2, 1)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *ip->Reg1 = static_cast<int>(vm.MEM[*ip->Reg2]);
+        ip++;
+        goto *ip->Handler;
+    L_STRO:
+        if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2 + ip->Value]) = *ip->Reg1;
+        ip++;
+        goto *ip->Handler;
+    L_LDRO:
+        if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *ip->Reg1 = *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2 + ip->Value]);
+        ip++;
+        goto *ip->Handler;
+    L_STBO:
+        if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, 1)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        vm.MEM[*ip->Reg2 + ip->Value] = static_cast<char>(*ip->Reg1);
+        ip++;
+        goto *ip->Handler;
+    L_LDBO:
+        if (checksBase<checked>(ip) && !inMemory(*ip->Reg2 + ip->Value, 1)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        *ip->Reg1 = static_cast<int>(vm.MEM[*ip->Reg2 + ip->Value]);
+        ip++;
+        goto *ip->Handler;
+    L_PUSH:
+        if (checked && !vm.inMemory(vm.REG[10], INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        vm.setInt(vm.REG[10], *ip->Reg1);
+        vm.REG[10] -= INT_SIZE;
+        ip++;
+        goto *ip->Handler;
+    L_POP:
+        if (checked && !vm.inMemory(vm.REG[10] + INT_SIZE, INT_SIZE)) {
+            ip = vm.memoryFault(ip);
+            goto *ip->Handler;
+        }
+        vm.REG[10] += INT_SIZE;
+        *ip->Reg1 = vm.getInt(vm.REG[10]);
+        ip++;
+        goto *ip->Handler;
+    L_FRAME:
+        ip = vm.enterFrame<checked>(ip);
+        goto *ip->Handler;
+    L_FRAMEG:
+        ip = vm.enterGuardedFrame<checked>(ip);
+        goto *ip->Handler;
+    L_CALL:
+        ip = vm.callFrame<checked>(ip);
+        goto *ip->Handler;
+    L_RET:
+        ip = vm.returnFrame<checked>(ip);
+        goto *ip->Handler;
+    L_STRO_LDRO_LDRO:
+        ip = vm.superStep<checked, STRO, LDRO, LDRO>(ip);
+        goto *ip->Handler;
+    L_LDRO_LDR_CMP:
+        ip = vm.superStep<checked, LDRO, LDR, CMP>(ip);
+        goto *ip->Handler;
+    L_LDR_MUL_ADD:
+        ip = vm.superStep<checked, LDR, MUL, ADD>(ip);
+        goto *ip->Handler;
+    L_STRO_LDRO:
+        ip = vm.superStep<checked, STRO, LDRO>(ip);
+        goto *ip->Handler;
+    L_LDRO_LDRO:
+        ip = vm.superStep<checked, LDRO, LDRO>(ip);
+        goto *ip->Handler;
+    L_LDRO_LDR:
+        ip = vm.superStep<checked, LDRO, LDR>(ip);
+        goto *ip->Handler;
+    L_MOV_LDRO:
+        ip = vm.superStep<checked, MOV, LDRO>(ip);
+        goto *ip->Handler;
+    L_MOV_MOV:
+        ip = vm.superStep<checked, MOV, MOV>(ip);
+        goto *ip->Handler;
+    L_LDR_CMP:
+        ip = vm.superStep<checked, LDR, CMP>(ip);
+        goto *ip->Handler;
+    L_ADD_STRO:
+        ip = vm.superStep<checked, ADD, STRO>(ip);
+        goto *ip->Handler;
+    L_MUL_MOV:
+        ip = vm.superStep<checked, MUL, MOV>(ip);
+        goto *ip->Handler;
+    L_LDR_ADD:
+        ip = vm.superStep<checked, LDR, ADD>(ip);
+        goto *ip->Handler;
+    L_LDRO_FRAME:
+        ip = vm.superStep<checked, LDRO, FRAME>(ip);
+        goto *ip->Handler;
+    L_NOP:
+        ip++;
+        goto *ip->Handler;
+    L_TRP:
+        if (trap(ip->Value)) {
+            REG[8] = ip->Addr + FIX_LENGTH;
+            return;
+        }
+        ip++;
+        goto *ip->Handler;
+    L_ERR_OPRAND:
+        REG[8] = ip->Addr;
+        std::cout << "Unexpected Error!" << std::endl;
+        return;
+    L_ERR_MEMORY:
+        REG[8] = ip->Addr;
+        std::cout << "Memory Access Error!" << std::endl;
+        return;
+    L_ERR_OPCODE:
+        REG[8] = ip->Addr;
+        std::cout << "Unexpected OpCode Error!" << std::endl;
+    }
+#else
+    // call-threaded engine: each handler returns the next instruction, or nullptr to stop
+    void runThreaded() {
+        for (int i = 0; i < static_cast<int>(program.size()); i++) {
+            switch (program[i].OpCode) {
+                case JMP:
+                    program[i].Handler = & VM::opJMP;
+                    break;
+                case JMR:
+                    program[i].Handler = & VM::opJMR;
+                    break;
+                case BNZ:
+                    program[i].Handler = & VM::opBNZ;
+                    break;
+                case BGT:
+                    program[i].Handler = & VM::opBGT;
+                    break;
+                case BLT:
+                    program[i].Handler = & VM::opBLT;
+                    break;
+                case BRZ:
+                    program[i].Handler = & VM::opBRZ;
+                    break;
+                case BLTR:
+                    program[i].Handler = & VM::opBLTR;
+                    break;
+                case BGTR:
+                    program[i].Handler = & VM::opBGTR;
+                    break;
+                case BEQR:
+                    program[i].Handler = & VM::opBEQR;
+                    break;
+                case BNER:
+                    program[i].Handler = & VM::opBNER;
+                    break;
+                case BLER:
+                    program[i].Handler = & VM::opBLER;
+                    break;
+                case BGER:
+                    program[i].Handler = & VM::opBGER;
+                    break;
+                case MOV:
+                    program[i].Handler = & VM::opMOV;
+                    break;
+                case LDA:
+                    program[i].Handler = & VM::opLDA;
+                    break;
+                case STR:
+                    program[i].Handler = & VM::opSTR;
+                    break;
+                case LDR:
+                    program[i].Handler = & VM::opLDR;
+                    break;
+                case STB:
+                    program[i].Handler = & VM::opSTB;
+                    break;
+                case LDB:
+                    program[i].Handler = & VM::opLDB;
+                    break;
+                case ADD:
+                    program[i].Handler = & VM::opADD;
+                    break;
+                case ADI:
+                    program[i].Handler = & VM::opADI;
+                    break;
+                case SUB:
+                    program[i].Handler = & VM::opSUB;
+                    break;
+                case MUL:
+                    program[i].Handler = & VM::opMUL;
+                    break;
+                case DIV:
+                    program[i].Handler = & VM::opDIV;
+                    break;
+                case AND:
+                    program[i].Handler = & VM::opAND;
+                    break;
+                case OR:
+                    program[i].Handler = & VM::opOR;
+                    break;
+                case CMP:
+                    program[i].Handler = & VM::opCMP;
+                    break;
+                case STRI:
+                    program[i].Handler = & VM::opSTRI;
+                    break;
+                case LDRI:
+                    program[i].Handler = & VM::opLDRI;
+                    break;
+                case STBI:
+                    program[i].Handler = & VM::opSTBI;
+                    break;
+                case LDBI:
+                    program[i].Handler = & VM::opLDBI;
+                    break;
+                case STRO:
+                    program[i].Handler = & VM::opSTRO;
+                    break;
+                case LDRO:
+                    program[i].Handler = & VM::opLDRO;
+                    break;
+                case STBO:
+                    program[i].Handler = & VM::opSTBO;
+                    break;
+                case LDBO:
+                    program[i].Handler = & VM::opLDBO;
+                    break;
+                case PUSH:
+                    program[i].Handler = & VM::opPUSH;
+                    break;
+                case POP:
+                    program[i].Handler = & VM::opPOP;
+                    break;
+                case FRAME:
+                    program[i].Handler = & VM::opFRAME;
+                    break;
+                case FRAMEG:
+                    program[i].Handler = & VM::opFRAMEG;
+                    break;
+                case CALL:
+                    program[i].Handler = & VM::opCALL;
+                    break;
+                case RET:
+                case RETV:
+                    program[i].Handler = & VM::opRET;
+                    break;
+                case STRO_LDRO_LDRO:
+                    program[i].Handler = & VM::opSTRO_LDRO_LDRO;
+                    break;
+                case LDRO_LDR_CMP:
+                    program[i].Handler = & VM::opLDRO_LDR_CMP;
+                    break;
+                case LDR_MUL_ADD:
+                    program[i].Handler = & VM::opLDR_MUL_ADD;
+                    break;
+                case STRO_LDRO:
+                    program[i].Handler = & VM::opSTRO_LDRO;
+                    break;
+                case LDRO_LDRO:
+                    program[i].Handler = & VM::opLDRO_LDRO;
+                    break;
+                case LDRO_LDR:
+                    program[i].Handler = & VM::opLDRO_LDR;
+                    break;
+                case MOV_LDRO:
+                    program[i].Handler = & VM::opMOV_LDRO;
+                    break;
+                case MOV_MOV:
+                    program[i].Handler = & VM::opMOV_MOV;
+                    break;
+                case LDR_CMP:
+                    program[i].Handler = & VM::opLDR_CMP;
+                    break;
+                case ADD_STRO:
+                    program[i].Handler = & VM::opADD_STRO;
+                    break;
+                case MUL_MOV:
+                    program[i].Handler = & VM::opMUL_MOV;
+                    break;
+                case LDR_ADD:
+                    program[i].Handler = & VM::opLDR_ADD;
+                    break;
+                case LDRO_FRAME:
+                    program[i].Handler = & VM::opLDRO_FRAME;
+                    break;
+                case NOP:
+                    program[i].Handler = & VM::opNOP;
+                    break;
+                case TRP:
+                    program[i].Handler = & VM::opTRP;
+                    break;
+                case ERR_OPRAND:
+                    program[i].Handler = & VM::opERR_OPRAND;
+                    break;
+                default:
+                    program[i].Handler = & VM::opERR_OPCODE;
+                    break;
+            }
+        }
+        faultOp.Handler = & VM::opERR_MEMORY;
+        DecodedOp * ip = findOp(REG[8]);
+        while (ip != nullptr) {
+            ip = ip->Handler(*this, ip);
+        }
+    }
+    
+    static DecodedOp * opJMP(VM &, DecodedOp * ip) {
+        ip = ip->Target;
+        return ip;
+    }
+    
+    static DecodedOp * opJMR(VM & vm, DecodedOp * ip) {
+        ip = vm.findOp(*ip->Reg1);
+        return ip;
+    }
+    
+    static DecodedOp * opBNZ(VM &, DecodedOp * ip) {
+        ip = (*ip->Reg1 != 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBGT(VM &, DecodedOp * ip) {
+        ip = (*ip->Reg1 > 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBLT(VM &, DecodedOp * ip) {
+        ip = (*ip->Reg1 < 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBRZ(VM &, DecodedOp * ip) {
+        ip = (*ip->Reg1 == 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBLTR(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) < 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBGTR(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) > 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBEQR(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) == 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBNER(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) != 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBLER(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) <= 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opBGER(VM & vm, DecodedOp * ip) {
+        ip = (difference(*ip->Reg1, vm.REG[ip->Value]) >= 0) ? ip->Target : ip + 1;
+        return ip;
+    }
+    
+    static DecodedOp * opMOV(VM &, DecodedOp * ip) {
+        *ip->Reg1 = *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDA(VM &, DecodedOp * ip) {
+        *ip->Reg1 = ip->Value;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTR(VM &, DecodedOp * ip) {
+        *reinterpret_cast<int *>(ip->Mem) = *ip->Reg1;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDR(VM &, DecodedOp * ip) {
+        *ip->Reg1 = *reinterpret_cast<int *>(ip->Mem);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTB(VM &, DecodedOp * ip) {
+        *ip->Mem = static_cast<char>(*ip->Reg1);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDB(VM &, DecodedOp * ip) {
+        *ip->Reg1 = static_cast<int>(*ip->Mem);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opADD(VM &, DecodedOp * ip) {
+        *ip->Reg1 += *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opADI(VM &, DecodedOp * ip) {
+        *ip->Reg1 += ip->Value;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSUB(VM &, DecodedOp * ip) {
+        *ip->Reg1 -= *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opMUL(VM &, DecodedOp * ip) {
+        *ip->Reg1 *= *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opDIV(VM &, DecodedOp * ip) {
+        *ip->Reg1 /= *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opAND(VM &, DecodedOp * ip) {
+        *ip->Reg1 = (*ip->Reg1 == 0 || *ip->Reg2 == 0) ? 0 : 1;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opOR(VM &, DecodedOp * ip) {
+        *ip->Reg1 = (*ip->Reg1 == 0 && *ip->Reg2 == 0) ? 0 : 1;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opCMP(VM &, DecodedOp * ip) {
+        *ip->Reg1 -= *ip->Reg2;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTRI(VM & vm, DecodedOp * ip) {
+        if (!vm.inMemory(*ip->Reg2, INT_SIZE)) return vm.memoryFault(ip);
+        *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2]) = *ip->Reg1;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDRI(VM & vm, DecodedOp * ip) {
+        if (!vm.inMemory(*ip->Reg2, INT_SIZE)) return vm.memoryFault(ip);
+        *ip->Reg1 = *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2]);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTBI(VM & vm, DecodedOp * ip) {
+        if (!vm.inMemory(*ip->Reg2, 1)) return vm.memoryFault(ip);
+        vm.MEM[*ip->Reg2] = static_cast<char>(*ip->Reg1);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDBI(VM & vm, DecodedOp * ip) {
+        if (!vm.inMemory(*ip->Reg2, 1)) return vm.memoryFault(ip);
+        *ip->Reg1 = static_cast<int>(vm.MEM[*ip->Reg2]);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTRO(VM & vm, DecodedOp * ip) {
+        if ((vm.memoryChecks || ip->Reg2 != & vm.REG[11]) && !vm.inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) return vm.memoryFault(ip);
+        *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2 + ip->Value]) = *ip->Reg1;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDRO(VM & vm, DecodedOp * ip) {
+        if ((vm.memoryChecks || ip->Reg2 != & vm.REG[11]) && !vm.inMemory(*ip->Reg2 + ip->Value, INT_SIZE)) return vm.memoryFault(ip);
+        *ip->Reg1 = *reinterpret_cast<int *>(& vm.MEM[*ip->Reg2 + ip->Value]);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opSTBO(VM & vm, DecodedOp * ip) {
+        if ((vm.memoryChecks || ip->Reg2 != & vm.REG[11]) && !vm.inMemory(*ip->Reg2 + ip->Value, 1)) return vm.memoryFault(ip);
+        vm.MEM[*ip->Reg2 + ip->Value] = static_cast<char>(*ip->Reg1);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opLDBO(VM & vm, DecodedOp * ip) {
+        if ((vm.memoryChecks || ip->Reg2 != & vm.REG[11]) && !vm.inMemory(*ip->Reg2 + ip->Value, 1)) return vm.memoryFault(ip);
+        *ip->Reg1 = static_cast<int>(vm.MEM[*ip->Reg2 + ip->Value]);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opPUSH(VM & vm, DecodedOp * ip) {
+        if (vm.memoryChecks && !vm.inMemory(vm.REG[10], INT_SIZE)) return vm.memoryFault(ip);
+        vm.setInt(vm.REG[10], *ip->Reg1);
+        vm.REG[10] -= INT_SIZE;
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opPOP(VM & vm, DecodedOp * ip) {
+        if (vm.memoryChecks && !vm.inMemory(vm.REG[10] + INT_SIZE, INT_SIZE)) return vm.memoryFault(ip);
+        vm.REG[10] += INT_SIZE;
+        *ip->Reg1 = vm.getInt(vm.REG[10]);
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opFRAME(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.enterFrame<true>(ip) : vm.enterFrame<false>(ip);
+    }
+    
+    static DecodedOp * opFRAMEG(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.enterGuardedFrame<true>(ip) : vm.enterGuardedFrame<false>(ip);
+    }
+    
+    static DecodedOp * opCALL(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.callFrame<true>(ip) : vm.callFrame<false>(ip);
+    }
+    
+    static DecodedOp * opRET(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.returnFrame<true>(ip) : vm.returnFrame<false>(ip);
+    }
+    
+    static DecodedOp * opSTRO_LDRO_LDRO(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, STRO, LDRO, LDRO>(ip) : vm.superStep<false, STRO, LDRO, LDRO>(ip);
+    }
+    
+    static DecodedOp * opLDRO_LDR_CMP(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDRO, LDR, CMP>(ip) : vm.superStep<false, LDRO, LDR, CMP>(ip);
+    }
+    
+    static DecodedOp * opLDR_MUL_ADD(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDR, MUL, ADD>(ip) : vm.superStep<false, LDR, MUL, ADD>(ip);
+    }
+    
+    static DecodedOp * opSTRO_LDRO(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, STRO, LDRO>(ip) : vm.superStep<false, STRO, LDRO>(ip);
+    }
+    
+    static DecodedOp * opLDRO_LDRO(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDRO, LDRO>(ip) : vm.superStep<false, LDRO, LDRO>(ip);
+    }
+    
+    static DecodedOp * opLDRO_LDR(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDRO, LDR>(ip) : vm.superStep<false, LDRO, LDR>(ip);
+    }
+    
+    static DecodedOp * opMOV_LDRO(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, MOV, LDRO>(ip) : vm.superStep<false, MOV, LDRO>(ip);
+    }
+    
+    static DecodedOp * opMOV_MOV(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, MOV, MOV>(ip) : vm.superStep<false, MOV, MOV>(ip);
+    }
+    
+    static DecodedOp * opLDR_CMP(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDR, CMP>(ip) : vm.superStep<false, LDR, CMP>(ip);
+    }
+    
+    static DecodedOp * opADD_STRO(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, ADD, STRO>(ip) : vm.superStep<false, ADD, STRO>(ip);
+    }
+    
+    static DecodedOp * opMUL_MOV(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, MUL, MOV>(ip) : vm.superStep<false, MUL, MOV>(ip);
+    }
+    
+    static DecodedOp * opLDR_ADD(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDR, ADD>(ip) : vm.superStep<false, LDR, ADD>(ip);
+    }
+    
+    static DecodedOp * opLDRO_FRAME(VM & vm, DecodedOp * ip) {
+        return vm.memoryChecks ? vm.superStep<true, LDRO, FRAME>(ip) : vm.superStep<false, LDRO, FRAME>(ip);
+    }
+    
+    static DecodedOp * opNOP(VM &, DecodedOp * ip) {
+        ip++;
+        return ip;
+    }
+    
+    static DecodedOp * opTRP(VM & vm, DecodedOp * ip) {
+        if (vm.trap(ip->Value)) {
+            vm.REG[8] = ip->Addr + FIX_LENGTH;
+            return nullptr;
+        }
+        return ip + 1;
+    }
+    
+    static DecodedOp * opERR_OPRAND(VM & vm, DecodedOp * ip) {
+        vm.REG[8] = ip->Addr;
+        std::cout << "Unexpected Error!" << std::endl;
+        return nullptr;
+    }
+    
+    static DecodedOp * opERR_MEMORY(VM & vm, DecodedOp * ip) {
+        vm.REG[8] = ip->Addr;
+        std::cout << "Memory Access Error!" << std::endl;
+        return nullptr;
+    }
+    
+    static DecodedOp * opERR_OPCODE(VM & vm, DecodedOp * ip) {
+        vm.REG[8] = ip->Addr;
+        std::cout << "Unexpected OpCode Error!" << std::endl;
+        return nullptr;
+    }
+#endif
 };
 
 #endif /* vm_hpp */